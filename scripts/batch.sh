@@ -0,0 +1,42 @@
+#!/bin/bash
+#SBATCH --nodes=1
+#SBATCH --ntasks=1
+#SBATCH -o ../results/logs/batch_%j.log
+#SBATCH -e ../results/errors/batch_%j.err
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 4 ]; then
+    echo "Usage: $0 <n_instances> <min_size> <max_size> <thread_list>"
+    exit 1
+fi
+
+N_INSTANCES=$1
+MIN_SIZE=$2
+MAX_SIZE=$3
+THREAD_LIST=$4
+
+# generate the batch: for each matrix its size, then a random initial diagonal (awk, no bc on the nodes)
+INPUT_FILE=../results/batch_${N_INSTANCES}_${MIN_SIZE}_${MAX_SIZE}.txt
+awk -v n=$N_INSTANCES -v min=$MIN_SIZE -v max=$MAX_SIZE 'BEGIN {
+    srand(42);
+    for (k = 0; k < n; k++) {
+        N = min + int(rand() * (max - min + 1));
+        printf "%d", N;
+        for (i = 0; i < N; i++) printf " %.6f", rand();
+        printf "\n";
+    }
+}' > $INPUT_FILE
+
+OUT_FILE=../results/batch_results.txt
+# if the file does not exists, create it with the header
+if [ ! -f $OUT_FILE ]; then
+    echo "n_instances n_workers time instances_per_s baseline_instances_per_s" > $OUT_FILE
+fi
+
+# Convert thread list to an array
+IFS=',' read -r -a THREAD_ARRAY <<< "$THREAD_LIST"
+
+for THREADS in "${THREAD_ARRAY[@]}"; do
+    echo "instances=$N_INSTANCES, N in [$MIN_SIZE, $MAX_SIZE], threads=$THREADS"
+    ../out/batch $INPUT_FILE $THREADS 1 0 $OUT_FILE
+done
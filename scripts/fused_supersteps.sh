@@ -0,0 +1,41 @@
+#!/bin/bash
+#SBATCH --nodes=1
+#SBATCH --ntasks=1
+#SBATCH -o ../results/logs/ff_fused_%j.log
+#SBATCH -e ../results/errors/ff_fused_%j.err
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 4 ]; then
+    echo "Usage: $0 <problem_size> <n_tries> <thread_list> <k_list>"
+    exit 1
+fi
+
+PROBLEM_SIZE=$1
+N_TRIES=$2
+THREAD_LIST=$3
+K_LIST=$4
+
+# Check if the provided number of tries is a positive integer
+if ! [[ "$N_TRIES" =~ ^[0-9]+$ ]]; then
+    echo "Error: The number of tries must be a positive integer."
+    exit 1
+fi
+
+OUT_FILE=../results/fused_results.txt
+# if the file does not exists, create it with the header
+if [ ! -f $OUT_FILE ]; then
+    echo "N n_workers k round_trips time time_fused" > $OUT_FILE
+fi
+
+# Convert the lists to arrays
+IFS=',' read -r -a THREAD_ARRAY <<< "$THREAD_LIST"
+IFS=',' read -r -a K_ARRAY <<< "$K_LIST"
+
+for THREADS in "${THREAD_ARRAY[@]}"; do
+    for K in "${K_ARRAY[@]}"; do
+        echo " N=$PROBLEM_SIZE, threads=$THREADS, k=$K for $N_TRIES times"
+        for ((i = 1; i <= N_TRIES; i++)); do
+            ../out/parallel_ff_fused $PROBLEM_SIZE $THREADS $K $OUT_FILE
+        done
+    done
+done
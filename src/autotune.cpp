@@ -0,0 +1,138 @@
+#include "sequential_wf.hpp"
+#include "farm_wf.hpp"
+#include "farm_block_cyclic.hpp"
+#include "omp_wf.hpp"
+#include "tuning_wf.hpp"
+#include "dispatch_wf.hpp"
+#include <omp.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <map>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N_max, probe_N_max, repetitions]\n", program_name);
+    std::printf("Searches the best backend (sequential, farm, block-cyclic farm, OpenMP), number of workers, chunk size and\n"
+                "scheduling policy for each range of N [2^k, 2^(k+1)) up to N_max, with probe runs on matrices of size\n"
+                "min(2^k, probe_N_max). The results are saved in the tuning file (WF_TUNING_FILE, default ../results/tuning.txt),\n"
+                "and used by the drivers when they are run without explicit parameters.\n");
+    std::printf("     N_max: largest N to tune for (default 32768)\n");
+    std::printf("     probe_N_max: largest matrix used for the probes (default 1024)\n");
+    std::printf("     repetitions: runs of each probe, the fastest is kept (default 2)\n");
+}
+
+// fastest of `repetitions` runs on a fresh matrix of size N
+double probe(const TuningConfig &config, uint64_t N, int repetitions)
+{
+    static Matrix M;
+    if (M.size() != N)
+        M.assign(N, Row(N, 0.0));
+    double best = 0;
+    for (int r = 0; r < repetitions; ++r)
+    {
+        for (uint64_t i = 0; i < N; ++i) // the kernels overwrite everything else
+            M[i][i] = double(i + 1) / double(N);
+        auto start = std::chrono::steady_clock::now();
+        run_backend(config, M, N);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+std::vector<TuningConfig> search_space(uint64_t N)
+{
+    int max_workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> workers;
+    for (int nw = 1; nw < max_workers; nw *= 2)
+        workers.push_back(nw);
+    workers.push_back(max_workers);
+
+    std::vector<TuningConfig> configs;
+    configs.push_back({"sequential", 1, 1, false});
+    for (int nw : workers)
+    {
+        configs.push_back({"farm", nw, 1, false});
+        configs.push_back({"omp", nw, 1, false});
+        for (size_t chunksize : {1, 4, 16, 64})
+        {
+            if (chunksize * nw > N)
+                continue;
+            configs.push_back({"block_cyclic", nw, chunksize, false});
+            configs.push_back({"block_cyclic", nw, chunksize, true});
+        }
+    }
+    return configs;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t N_max = 32768;
+    uint64_t probe_N_max = 1024;
+    int repetitions = 2;
+    if (argc > 4 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 4 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        N_max = std::stoull(argv[1]);
+    }
+    if (argc > 2)
+    {
+        probe_N_max = std::stoull(argv[2]);
+    }
+    if (argc > 3)
+    {
+        repetitions = std::stoi(argv[3]);
+    }
+    if (N_max < 128 || probe_N_max < 16 || repetitions < 1)
+    {
+        std::cout << "Error: N_max must be at least 128, probe_N_max at least 16, repetitions at least 1" << std::endl;
+        return -1;
+    }
+
+    auto machine = machine_key();
+    std::cout << "machine: " << machine << std::endl;
+    std::map<uint64_t, std::map<std::string, TuningConfig>> best_by_probe; // probe N -> backend -> best configuration
+    std::vector<TuningEntry> entries;
+    for (uint64_t N_lo = 128; N_lo <= N_max; N_lo *= 2)
+    {
+        uint64_t probe_N = std::min(N_lo, probe_N_max);
+        if (!best_by_probe.count(probe_N))
+        {
+            std::cout << "probing N = " << probe_N << std::endl;
+            auto &best = best_by_probe[probe_N];
+            for (auto config : search_space(probe_N))
+            {
+                config.probe_seconds = probe(config, probe_N, repetitions);
+                std::cout << "  " << std::setw(12) << config.backend << " workers " << std::setw(3) << config.nworkers;
+                if (config.backend == "block_cyclic")
+                    std::cout << " chunksize " << std::setw(3) << config.chunksize << (config.on_demand ? " on demand  " : " round robin");
+                std::cout << " " << config.probe_seconds << "s" << std::endl;
+                if (!best.count(config.backend) || config.probe_seconds < best[config.backend].probe_seconds)
+                    best[config.backend] = config;
+            }
+        }
+        for (auto &[backend, config] : best_by_probe[probe_N])
+            entries.push_back({machine, N_lo, N_lo * 2, config});
+    }
+
+    for (auto &[probe_N, best] : best_by_probe)
+    {
+        auto fastest = std::min_element(best.begin(), best.end(), [](auto &a, auto &b)
+                                        { return a.second.probe_seconds < b.second.probe_seconds; });
+        std::cout << "N = " << probe_N << ": fastest is " << fastest->first << " with " << fastest->second.nworkers
+                  << " workers, " << fastest->second.probe_seconds << "s" << std::endl;
+    }
+    if (!save_tuning(entries))
+    {
+        std::cout << "Error: unable to write the tuning file " << tuning_filename() << std::endl;
+        return -1;
+    }
+    std::cout << "tuning saved to " << tuning_filename() << std::endl;
+    return 0;
+}
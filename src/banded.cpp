@@ -0,0 +1,141 @@
+#include "band_wf.hpp"
+#include "sequential_wf.hpp"
+#include "reference_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N, K, backend, nworkers, filename]\n", program_name);
+    std::printf("Computes only the first K superdiagonals of a matrix of size N, in O(N K) memory instead of N^2.\n");
+    std::printf("     N: size of the square matrix (default 100000, the band then takes about 1.5 GiB)\n");
+    std::printf("     K: last diagonal computed (default 1000, at most N-1)\n");
+    std::printf("     backend: sequential, farm or omp (default omp)\n");
+    std::printf("     nworkers: number of workers of the farm and of the OpenMP threads (default: the hardware threads)\n");
+    std::printf("     filename: name of the file to append the results to (default None, results are just printed)\n");
+    std::printf("With WF_VALIDATE=1 the band is compared with the full sequential computation (N up to 4096).\n");
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t N = 100000;
+    uint64_t K = 1000;
+    std::string backend = "omp";
+    int nworkers = std::max(1u, std::thread::hardware_concurrency());
+    std::string filename;
+    if (argc > 6 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 6 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        N = std::stoull(argv[1]);
+    }
+    if (argc > 2)
+    {
+        K = std::stoull(argv[2]);
+    }
+    if (argc > 3)
+    {
+        backend = argv[3];
+    }
+    if (argc > 4)
+    {
+        nworkers = std::stoi(argv[4]);
+    }
+    if (argc > 5)
+    {
+        filename = argv[5];
+    }
+    if (N < 1 || nworkers < 1)
+    {
+        std::cout << "Error: N and nworkers must be greater than 0" << std::endl;
+        return -1;
+    }
+    if (backend != "sequential" && backend != "farm" && backend != "omp")
+    {
+        std::cout << "Error: unknown backend " << backend << std::endl;
+        return -1;
+    }
+
+    // 2 N (K+1) doubles, e.g. 16 GB for N = 1000000 and K = 1000
+    double required = 2 * double(N) * double(std::min(K, N - 1) + 1) * sizeof(double);
+    std::unique_ptr<BandMatrix> band;
+    try
+    {
+        band = std::make_unique<BandMatrix>(N, K);
+    }
+    catch (const std::bad_alloc &)
+    {
+        std::cout << "Error: cannot allocate the band, it needs " << required / double(1 << 20)
+                  << " MiB: reduce N or K" << std::endl;
+        return -1;
+    }
+    BandMatrix &B = *band;
+    for (uint64_t i = 0; i < N; ++i)
+    {
+        B.set_diagonal(i, double(i + 1) / double(N));
+    }
+    std::cout << "band of " << B.K << " diagonals: " << B.bytes() / double(1 << 20) << " MiB (the full matrix would take "
+              << double(N) * double(N) * sizeof(double) / double(1 << 20) << " MiB)" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    if (backend == "farm")
+    {
+        compute_band_par(B, nworkers);
+    }
+    else if (backend == "omp")
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(nworkers);
+#endif
+        compute_band_omp(B);
+    }
+    else
+    {
+        compute_band_sequential(B);
+    }
+    std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
+    // sum over the diagonals d <= K of (N-d) d multiply-adds
+    double work = 0;
+    for (uint64_t diag = 1; diag <= B.K; ++diag)
+        work += double(N - diag) * double(diag);
+    std::cout << "elapsed time: " << elapsed_seconds.count() << "s (" << work / elapsed_seconds.count() * 1e-9
+              << " G multiply-adds/s)\n";
+    if (!filename.empty())
+    {
+        std::ofstream file(filename, std::ios_base::app);
+        file << N << " " << B.K << " " << backend << " " << nworkers << " " << elapsed_seconds.count() << std::endl;
+    }
+
+    if (validation_enabled())
+    {
+        if (N > 4096)
+        {
+            std::cout << "Warning: N too large to validate against the full matrix" << std::endl;
+        }
+        else
+        {
+            Matrix M(N, Row(N, 0.0));
+            for (uint64_t i = 0; i < N; ++i)
+                M[i][i] = double(i + 1) / double(N);
+            compute_stencil_optim(M, N);
+            double max_error = 0;
+            for (uint64_t i = 0; i < N; ++i)
+                for (uint64_t j = i; j <= std::min(i + B.K, N - 1); ++j)
+                    max_error = std::max(max_error, std::abs(B.at(i, j) - M[i][j]));
+            std::cout << "validation: max difference from the full matrix " << max_error << std::endl;
+            if (max_error > 1e-9)
+                return -1;
+        }
+    }
+
+    std::cout << "M[0][" << B.K << "] = " << B.at(0, B.K) << std::endl;
+    return 0;
+}
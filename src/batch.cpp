@@ -0,0 +1,94 @@
+#include "batch_wf.hpp"
+#include <chrono>
+#include <iostream>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s input_file [nworkers, compare, threshold, filename]\n", program_name);
+    std::printf("Computes the wavefront of many matrices, read from input_file (for each matrix: N, then the N values of its diagonal).\n"
+                "Small matrices are computed whole by the workers of a farm, large ones one at a time with all the workers.\n");
+    std::printf("     nworkers: number of workers (default 4)\n");
+    std::printf("     compare: if 1, also runs compute_stencil_par on each matrix, one after the other, and compares (default 0)\n");
+    std::printf("     threshold: matrices with N >= threshold are computed with all the workers (default 0: chosen from the work of each matrix)\n");
+    std::printf("     filename: name of the file to write the results to (default batch_results.txt)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int nworkers = 4;
+    bool compare = false;
+    uint64_t threshold = 0;
+    std::string filename = "batch_results.txt";
+    if (argc < 2 || argc > 6 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")
+    {
+        show_help(argv[0]);
+        return argc < 2 ? -1 : 0;
+    }
+    if (argc > 2)
+    {
+        nworkers = std::stol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        compare = bool(std::stol(argv[3]));
+    }
+    if (argc > 4)
+    {
+        threshold = std::stoull(argv[4]);
+    }
+    if (argc > 5)
+    {
+        filename = argv[5];
+    }
+    if (nworkers < 1)
+    {
+        std::cout << "Error: nworkers must be greater than 0" << std::endl;
+        return -1;
+    }
+
+    auto batch = read_batch(argv[1]);
+    if (batch.empty())
+    {
+        std::cout << "Error: no matrices in " << argv[1] << std::endl;
+        return -1;
+    }
+    std::cout << "instances: " << batch.size() << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    auto stats = compute_batch(batch, nworkers, threshold);
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - start;
+    double throughput = batch.size() / elapsed_seconds.count();
+    std::cout << "small instances (whole, one per worker): " << stats.n_small << " in " << stats.small_seconds << "s\n";
+    std::cout << "large instances (farm on each): " << stats.n_large << " in " << stats.large_seconds << "s\n";
+    std::cout << "elapsed time: " << elapsed_seconds.count() << "s, " << throughput << " instances/s\n";
+
+    double baseline_throughput = 0;
+    if (compare)
+    {
+        start = std::chrono::steady_clock::now();
+        for (auto &instance : batch)
+        {
+            Matrix M(instance.N, Row(instance.N, 0.0));
+            init_instance(M, instance);
+            compute_stencil_par(M, instance.N, nworkers);
+            if (std::abs(M[0][instance.N - 1] - instance.result) > 1e-6)
+            {
+                std::cout << "Error: results differ for an instance with N = " << instance.N << ": " << M[0][instance.N - 1] << " != " << instance.result << std::endl;
+                return -1;
+            }
+        }
+        end = std::chrono::steady_clock::now();
+        std::chrono::duration<double> baseline_seconds = end - start;
+        baseline_throughput = batch.size() / baseline_seconds.count();
+        std::cout << "one farm per matrix: " << baseline_seconds.count() << "s, " << baseline_throughput << " instances/s (batch speedup "
+                  << throughput / baseline_throughput << ")\n";
+    }
+
+    // write number of instances, number of workers, time taken and throughput to a file
+    std::ofstream file;
+    file.open(filename, std::ios_base::app);
+    file << batch.size() << " " << nworkers << " " << elapsed_seconds.count() << " " << throughput << " " << baseline_throughput << std::endl;
+    file.close();
+    return 0;
+}
@@ -1,5 +1,5 @@
 #include "farm_wf.hpp"
-#include "sequential_wf.hpp"
+#include "reference_wf.hpp"
 #include <chrono>
 #include <iostream>
 
@@ -35,7 +35,7 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    std::vector<std::vector<double>> M(N, std::vector<double>(N, 0.0));
+    Matrix M(N, Row(N, 0.0));
 
     for(uint64_t i = 0; i < N; ++i) {
         for(uint64_t j = 0; j < N; ++j) {
@@ -46,18 +46,11 @@ int main(int argc, char *argv[]) {
         M[i][i] = double(i+1)/double(N);
     }
 
-    auto M1 = M;
     compute_stencil_par(M, N, nworkers);
-    compute_stencil_optim(M1, N);
 
-    // check correctness
-    for(uint64_t i = 0; i < N; ++i) {
-        for(uint64_t j = i; j < N; ++j) {
-            if (abs(M[i][j] - M1[i][j]) > 1e-6) {
-                std::cout << "Error: M[" << i << "][" << j << "] = " << M[i][j] << " != " << M1[i][j] << std::endl;
-                return -1;
-            }
-        }
+    // check correctness against the cached fingerprints of the sequential result (computed only the first time for each N)
+    if (!validate(M, N, "farm")) {
+        return -1;
     }
 
     std::cout << "Correctness check passed" << std::endl;
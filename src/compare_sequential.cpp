@@ -7,6 +7,7 @@
 #include<cmath>
 #include<fstream>
 #include "sequential_wf.hpp"
+#include "reference_wf.hpp"
 
 
 
@@ -24,7 +25,7 @@ int main( int argc, char *argv[] ) {
 
 
 	// allocate the matrix
-	std::vector<std::vector<double>> M(N, std::vector<double>(N, 0.0));
+	Matrix M(N, Row(N, 0.0));
 
     //init
 
@@ -68,14 +69,14 @@ int main( int argc, char *argv[] ) {
     elapsed_seconds = end-start;
     std::cout << "Elapsed time (all optimizations): " << elapsed_seconds.count() << "s\n";
 
-    // compare the results
-    for (uint64_t i = 0; i < N; ++i) {
-        for (uint64_t j = i; j < N; ++j) {
-            if (abs(M[i][j]-M3[i][j]) > 1e-6) {
-                std::cout << "Results differ at position (" << i << ", " << j << "): " << M[i][j] << " != " << M3[i][j] << std::endl;
-                return -1;
-            }
-        }
+    // compare the results with the reference (if it is not cached yet, M3 is the reference)
+    auto reference = get_reference(N, &M3);
+    bool ok = report_validation(compare_fingerprints(compute_fingerprints(M, N), reference), "naive");
+    ok = report_validation(compare_fingerprints(compute_fingerprints(M1, N), reference), "temp") && ok;
+    ok = report_validation(compare_fingerprints(compute_fingerprints(M2, N), reference), "i_plus_diag") && ok;
+    ok = report_validation(compare_fingerprints(compute_fingerprints(M3, N), reference), "all optimizations") && ok;
+    if (!ok) {
+        return -1;
     }
     std::cout << "All results are equal!\n";
 }
@@ -0,0 +1,150 @@
+#include "farm_wf.hpp"
+#include "farm_block_cyclic.hpp"
+#include "sync_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N_list, nworkers, jobs, filename]\n", program_name);
+    std::printf("Runs the same jobs (the sizes of N_list in turn) with a farm built for each job (compute_stencil_par) and\n"
+                "with a WavefrontFarm built once and frozen between jobs, for both farms, and prints the time per job and\n"
+                "the overhead saved per job by the frozen farm.\n");
+    std::printf("     N_list: sizes of the jobs, separated by commas (default 64,256)\n");
+    std::printf("     nworkers: number of workers (default 4)\n");
+    std::printf("     jobs: number of jobs of each kind (default 100)\n");
+    std::printf("     filename: name of the file to append the results to (default None, results are just printed)\n");
+}
+
+struct Jobs
+{
+    std::vector<uint64_t> sizes;
+    std::vector<Matrix> matrices; // one per size, the jobs of the same size reuse it
+    std::vector<double> results;
+
+    explicit Jobs(const std::vector<uint64_t> &sizes): sizes(sizes), results(sizes.size(), 0)
+    {
+        for (auto N : sizes)
+        {
+            matrices.emplace_back(N, Row(N, 0.0));
+            for (uint64_t i = 0; i < N; ++i)
+                matrices.back()[i][i] = double(i + 1) / double(N);
+        }
+    }
+
+    // runs the jobs with run(M, N), in seconds per job
+    template <typename Run>
+    double time(int jobs, Run run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int job = 0; job < jobs; ++job)
+        {
+            size_t s = job % sizes.size();
+            run(matrices[s], sizes[s]);
+            results[s] = matrices[s][0][sizes[s] - 1];
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / jobs;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    std::vector<uint64_t> sizes = {64, 256};
+    int nworkers = 4;
+    int jobs = 100;
+    std::string filename;
+    if (argc > 5 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 5 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        sizes.clear();
+        std::stringstream list(argv[1]);
+        std::string size;
+        while (std::getline(list, size, ','))
+            sizes.push_back(std::stoull(size));
+    }
+    if (argc > 2)
+    {
+        nworkers = std::stoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        jobs = std::stoi(argv[3]);
+    }
+    if (argc > 4)
+    {
+        filename = argv[4];
+    }
+    for (auto N : sizes)
+    {
+        if (N < 2)
+        {
+            std::cout << "Error: the sizes must be greater than 1" << std::endl;
+            return -1;
+        }
+    }
+    if (sizes.empty() || nworkers < 1 || jobs < 1)
+    {
+        std::cout << "Error: N_list, nworkers and jobs must not be empty or 0" << std::endl;
+        return -1;
+    }
+    auto sync_mode = sync_mode_from_env();
+    auto chunksize = [&](uint64_t N) { return std::max<size_t>(1, N / (16 * nworkers)); };
+
+    Jobs rebuilt(sizes), frozen(sizes);
+    std::cout << std::setprecision(4);
+    bool same = true;
+    for (std::string backend : {"farm", "block_cyclic"})
+    {
+        double rebuilt_seconds, frozen_seconds;
+        if (backend == "farm")
+        {
+            rebuilt_seconds = rebuilt.time(jobs, [&](Matrix &M, uint64_t N) {
+                compute_stencil_par(M, N, nworkers, false, 1, nullptr, nullptr, sync_mode);
+            });
+            // the farm is built in the first job, as a server would do for its first request
+            std::unique_ptr<WavefrontFarm> farm;
+            frozen_seconds = frozen.time(jobs, [&](Matrix &M, uint64_t N) {
+                if (!farm) farm = std::make_unique<WavefrontFarm>(nworkers, false, sync_mode);
+                farm->run(M, N);
+            });
+        }
+        else
+        {
+            rebuilt_seconds = rebuilt.time(jobs, [&](Matrix &M, uint64_t N) {
+                block_cyclic::compute_stencil_par(M, N, nworkers, chunksize(N), true, 1, nullptr, nullptr, sync_mode);
+            });
+            std::unique_ptr<block_cyclic::WavefrontFarm> farm;
+            frozen_seconds = frozen.time(jobs, [&](Matrix &M, uint64_t N) {
+                if (!farm) farm = std::make_unique<block_cyclic::WavefrontFarm>(nworkers, true, sync_mode);
+                farm->run(M, N, chunksize(N));
+            });
+        }
+        for (size_t s = 0; s < sizes.size(); ++s)
+            same = same && rebuilt.results[s] == frozen.results[s];
+        std::cout << backend << ": " << rebuilt_seconds * 1e3 << "ms per job rebuilding the farm, " << frozen_seconds * 1e3
+                  << "ms with the frozen farm, " << (rebuilt_seconds - frozen_seconds) * 1e6 << "us saved per job ("
+                  << rebuilt_seconds / frozen_seconds << "x)" << std::endl;
+        if (!filename.empty())
+        {
+            std::ofstream file(filename, std::ios_base::app);
+            file << argv[1] << " " << backend << " " << nworkers << " " << rebuilt_seconds << " " << frozen_seconds << std::endl;
+        }
+    }
+    for (size_t s = 0; s < sizes.size(); ++s)
+        std::cout << "M[0][" << sizes[s] - 1 << "] = " << frozen.results[s] << std::endl;
+    if (!same)
+    {
+        std::cout << "Error: the frozen farm does not compute the same matrices" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "farm_wf.hpp"
+#include "sequential_wf.hpp"
+#include "matrix_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N, nworkers, repetitions, filename]\n", program_name);
+    std::printf("Runs the wavefront on matrices allocated with each WF_MATRIX_ALLOC mode (standard, padded, thp, hugetlb)\n"
+                "and compares runtime, dTLB load misses and huge pages in use against the standard allocation.\n");
+    std::printf("     N: size of the square matrix (default 4096)\n");
+    std::printf("     nworkers: 1 for the sequential version, more for the FastFlow farm (default 1)\n");
+    std::printf("     repetitions: runs of each mode, the fastest is reported (default 1)\n");
+    std::printf("     filename: name of the file to append the results to (default None, results are just printed)\n");
+}
+
+// counts the dTLB load misses of this process and of the threads it creates after open()
+class DtlbCounter
+{
+public:
+    DtlbCounter()
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.inherit = 1; // the farm workers
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~DtlbCounter()
+    {
+        if (fd >= 0) close(fd);
+    }
+    bool available() const { return fd >= 0; }
+    void start()
+    {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    // inherited counts are only added when the threads exit, so this must be read after the farm has terminated
+    long long stop()
+    {
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+// anonymous memory of this process currently backed by transparent huge pages, in MiB
+double anon_huge_pages_mib()
+{
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    std::string key;
+    while (smaps >> key)
+    {
+        if (key == "AnonHugePages:")
+        {
+            double kib;
+            smaps >> kib;
+            return kib / 1024;
+        }
+        smaps.ignore(256, '\n');
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t N = 4096;
+    int nworkers = 1;
+    int repetitions = 1;
+    std::string filename;
+    if (argc > 5 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 5 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        N = std::stol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        nworkers = std::stol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        repetitions = std::stoi(argv[3]);
+    }
+    if (argc > 4)
+    {
+        filename = argv[4];
+    }
+    if (N < 1 || nworkers < 1 || repetitions < 1)
+    {
+        std::cout << "Error: N, nworkers and repetitions must be greater than 0" << std::endl;
+        return -1;
+    }
+
+    auto padding = matrix_allocation_from_env().row_padding;
+    DtlbCounter counter;
+    if (!counter.available())
+        std::cout << "Warning: dTLB counters not available (see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+
+    double standard_time = 0;
+    long long standard_misses = -1;
+    std::cout << std::left << std::setw(10) << "mode" << std::setw(14) << "time" << std::setw(16) << "dtlb_misses" << std::setw(12)
+              << "huge_MiB" << std::setw(10) << "speedup" << "miss_ratio" << std::endl;
+    for (auto mode : {MatrixAllocation::standard, MatrixAllocation::padded, MatrixAllocation::thp, MatrixAllocation::hugetlb})
+    {
+        set_matrix_allocation(mode, padding);
+        double best_time = 0;
+        long long best_misses = -1;
+        double huge_mib = 0;
+        for (int r = 0; r < repetitions; ++r)
+        {
+            Matrix M(N, Row(N, 0.0));
+            for (uint64_t i = 0; i < N; ++i)
+            {
+                M[i][i] = double(i + 1) / double(N);
+            }
+            huge_mib = anon_huge_pages_mib();
+
+            counter.start();
+            auto start = std::chrono::steady_clock::now();
+            if (nworkers == 1)
+                compute_stencil_optim(M, N);
+            else
+                compute_stencil_par(M, N, nworkers);
+            auto end = std::chrono::steady_clock::now();
+            long long misses = counter.stop();
+            double time = std::chrono::duration<double>(end - start).count();
+            if (r == 0 || time < best_time)
+            {
+                best_time = time;
+                best_misses = misses;
+            }
+        }
+        if (mode == MatrixAllocation::standard)
+        {
+            standard_time = best_time;
+            standard_misses = best_misses;
+        }
+        std::cout << std::setw(10) << matrix_allocation_name(mode) << std::setw(14) << best_time << std::setw(16) << best_misses
+                  << std::setw(12) << huge_mib << std::setw(10) << standard_time / best_time;
+        if (best_misses >= 0 && standard_misses > 0)
+            std::cout << double(best_misses) / double(standard_misses);
+        else
+            std::cout << "n/a";
+        std::cout << std::endl;
+
+        if (!filename.empty())
+        {
+            std::ofstream file(filename, std::ios::app);
+            file << N << " " << nworkers << " " << matrix_allocation_name(mode) << " " << padding << " " << best_time << " "
+                 << best_misses << " " << huge_mib << std::endl;
+        }
+    }
+    return 0;
+}
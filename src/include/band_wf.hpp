@@ -0,0 +1,154 @@
+#ifndef BAND_WF_HPP
+#define BAND_WF_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <ff/ff.hpp>
+#include <ff/farm.hpp>
+#include "matrix_wf.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ------------------------------------------------------------------
+// ------------------------- BANDED WAVEFRONT -----------------------
+// ------------------------------------------------------------------
+// Only the diagonals 0..K of the upper triangle, for K << N. Element (i, i+d) only depends on the elements of
+// the diagonals below d, so the band is computed exactly as the first K diagonals of the full matrix, in
+// 2N(K+1) doubles instead of N^2 and about N K^2 / 2 multiply-adds.
+// The band is stored twice, as the full kernels store both triangles:
+//   upper: row i holds M[i][i], M[i][i+1], ..., M[i][i+K]
+//   lower: row c holds M[c][c], M[c][c-1], ..., M[c][c-K] (the mirrored elements M[c-d][c])
+// so the dot product of element (i, i+d), sum_j M[i][i+j] * M[i+d][i+d-j], reads two contiguous rows.
+
+class BandMatrix {
+public:
+    // K is capped at N-1
+    BandMatrix(uint64_t N, uint64_t K):
+        N(N), K(std::min(K, N - 1)), stride(this->K + 1), upper(N * stride, 0.0), lower(N * stride, 0.0) {}
+
+    double *upper_row(uint64_t i) { return upper.data() + i * stride; }
+    double *lower_row(uint64_t c) { return lower.data() + c * stride; }
+
+    void set_diagonal(uint64_t i, double value) {
+        upper_row(i)[0] = value;
+        lower_row(i)[0] = value;
+    }
+
+    // M[i][j], for i <= j <= i+K
+    double at(uint64_t i, uint64_t j) const { return upper[i * stride + (j - i)]; }
+
+    size_t bytes() const { return 2 * N * stride * sizeof(double); }
+
+    const uint64_t N;
+    const uint64_t K;
+
+private:
+    const uint64_t stride;
+    Row upper, lower;
+};
+
+// elements begin..end-1 of diagonal diag
+void inline compute_band_rows(BandMatrix &B, uint64_t diag, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; ++i) {
+        const double *row = B.upper_row(i);
+        const double *col = B.lower_row(i + diag);
+        double temp = 0.0;
+        for (uint64_t j = 0; j < diag; ++j)
+            temp += row[j] * col[j];
+        temp = std::cbrt(temp);
+        B.upper_row(i)[diag] = temp;
+        B.lower_row(i + diag)[diag] = temp;
+    }
+}
+
+// Column by column instead of diagonal by diagonal: M[i][c] needs the columns before c in row i and the rows
+// below i in column c, so going up each column is also a valid order, and it only touches the last K+1 rows of
+// the band (which stay in cache) instead of sweeping the whole band for each diagonal.
+void inline compute_band_sequential(BandMatrix &B) {
+    for (uint64_t c = 1; c < B.N; ++c) {
+        const double *col = B.lower_row(c);
+        for (uint64_t diag = 1; diag <= std::min(c, B.K); ++diag) {
+            uint64_t i = c - diag;
+            const double *row = B.upper_row(i);
+            double temp = 0.0;
+            for (uint64_t j = 0; j < diag; ++j)
+                temp += row[j] * col[j];
+            temp = std::cbrt(temp);
+            B.upper_row(i)[diag] = temp;
+            B.lower_row(c)[diag] = temp;
+        }
+    }
+}
+
+// compile with -fopenmp, otherwise this is the sequential version
+void inline compute_band_omp(BandMatrix &B) {
+    for (uint64_t diag = 1; diag <= B.K; ++diag) {
+        uint64_t count = B.N - diag;
+        #pragma omp parallel for schedule(static)
+        for (uint64_t i = 0; i < count; ++i)
+            compute_band_rows(B, diag, i, i + 1);
+    }
+}
+
+// the farm of farm_wf.hpp on the band: the emitter sends each diagonal to all the workers, each computes its
+// block of rows, and the collector sends the diagonal back to the emitter when all the blocks are done
+namespace band {
+
+struct Emitter: ff::ff_monode_t<bool, uint64_t> {
+    Emitter(uint64_t K, int n_workers): K(K), n_workers(n_workers) {}
+    uint64_t *svc(bool *) {
+        diag++;
+        for (int nw = 0; nw < n_workers; ++nw)
+            ff_send_out(&diag);
+        return diag == K ? EOS : GO_ON;
+    }
+    uint64_t K;
+    int n_workers;
+    uint64_t diag = 0;
+};
+
+struct Worker: ff::ff_node_t<uint64_t, int> {
+    Worker(BandMatrix &B, int n_workers): B(B), n_workers(n_workers) {}
+    int *svc(uint64_t *diag_ptr) {
+        uint64_t diag = *diag_ptr, count = B.N - diag;
+        uint64_t id = get_my_id(), base = count / n_workers, remainder = count % n_workers;
+        uint64_t begin = id * base + std::min(id, remainder);
+        compute_band_rows(B, diag, begin, begin + base + (id < remainder ? 1 : 0));
+        return &done;
+    }
+    BandMatrix &B;
+    int n_workers;
+    int done = 1;
+};
+
+struct Collector: ff::ff_minode_t<int, bool> {
+    explicit Collector(int n_workers): n_workers(n_workers) {}
+    bool *svc(int *) {
+        if (++received < n_workers) return GO_ON;
+        received = 0;
+        return &diagonal_is_done;
+    }
+    int n_workers;
+    int received = 0;
+    bool diagonal_is_done = true;
+};
+
+} // namespace band
+
+void inline compute_band_par(BandMatrix &B, int nworkers) {
+    if (B.K < 1) return;
+    std::vector<std::unique_ptr<ff::ff_node>> W;
+    for (int i = 0; i < nworkers; ++i)
+        W.push_back(std::make_unique<band::Worker>(B, nworkers));
+    band::Emitter emitter(B.K, nworkers);
+    band::Collector collector(nworkers);
+    ff::ff_Farm<> farm(std::move(W), emitter, collector);
+    farm.wrap_around();
+    if (farm.run_and_wait_end() < 0)
+        ff::error("running band farm");
+}
+
+#endif // BAND_WF_HPP
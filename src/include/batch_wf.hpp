@@ -0,0 +1,135 @@
+#ifndef BATCH_WF_HPP
+#define BATCH_WF_HPP
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <ff/ff.hpp>
+#include <ff/farm.hpp>
+#include "sequential_wf.hpp"
+#include "farm_wf.hpp"
+
+// ------------------------------------------------------------------
+// ------------------------- BATCH OF MATRICES ----------------------
+// ------------------------------------------------------------------
+// Many independent wavefronts, each with its own N and initial diagonal. Small instances are computed whole by
+// the workers of a single farm (one instance per task, inter-instance parallelism, no synchronization per
+// diagonal); instances too large to be balanced that way are computed one at a time by a WavefrontFarm
+// with all the workers (intra-instance parallelism).
+
+struct Instance {
+    uint64_t N;
+    std::vector<double> diagonal; // initial values of M[i][i]
+    double result = 0;            // M[0][N-1]
+};
+
+// reads the instances from a text file: each instance is N followed by the N values of its diagonal
+inline std::vector<Instance> read_batch(const std::string &filename) {
+    std::vector<Instance> batch;
+    std::ifstream file(filename);
+    Instance instance;
+    while (file >> instance.N && instance.N > 0) {
+        instance.diagonal.resize(instance.N);
+        for (auto &value : instance.diagonal)
+            file >> value;
+        if (!file) break;
+        batch.push_back(instance);
+    }
+    return batch;
+}
+
+inline void init_instance(Matrix &M, const Instance &instance) {
+    // the kernels assign every element they compute, so a buffer larger than N can be reused as it is
+    for (uint64_t i = 0; i < instance.N; ++i)
+        M[i][i] = instance.diagonal[i];
+}
+
+// an instance is large if it alone takes more than the average work per worker: scheduling it whole on
+// one worker would leave the others idle at the end of the batch. threshold > 0 overrides this with a fixed N
+inline bool is_large_instance(const Instance &instance, double work_per_worker, uint64_t threshold) {
+    if (threshold > 0) return instance.N >= threshold;
+    return std::pow(double(instance.N), 3) / 6 > work_per_worker;
+}
+
+struct BatchEmitter: ff::ff_monode_t<Instance> {
+    BatchEmitter(std::vector<Instance *> &instances): instances(instances) {}
+    Instance* svc(Instance *) {
+        for (auto instance : instances)
+            ff_send_out(instance);
+        return EOS;
+    }
+    std::vector<Instance *> &instances;
+};
+
+struct BatchWorker: ff::ff_node_t<Instance> {
+    BatchWorker(uint64_t max_N): max_N(max_N) {}
+    int svc_init() {
+        if (M.empty()) M.assign(max_N, Row(max_N, 0.0)); // one matrix per worker, reused for all its instances
+        return 0;
+    }
+    Instance* svc(Instance *instance) {
+        init_instance(M, *instance);
+        compute_stencil_optim(M, instance->N);
+        instance->result = M[0][instance->N - 1];
+        return GO_ON;
+    }
+    uint64_t max_N;
+    Matrix M;
+};
+
+struct BatchStats {
+    size_t n_small = 0;
+    size_t n_large = 0;
+    double small_seconds = 0;
+    double large_seconds = 0;
+};
+
+inline BatchStats compute_batch(std::vector<Instance> &batch, int nworkers, uint64_t threshold = 0) {
+    BatchStats stats;
+    double total_work = 0;
+    for (auto &instance : batch)
+        total_work += std::pow(double(instance.N), 3) / 6;
+    std::vector<Instance *> small, large;
+    for (auto &instance : batch)
+        (is_large_instance(instance, total_work / nworkers, threshold) ? large : small).push_back(&instance);
+    // largest first, so the last tasks handed out on demand are the short ones
+    std::sort(small.begin(), small.end(), [](Instance *a, Instance *b) { return a->N > b->N; });
+    stats.n_small = small.size();
+    stats.n_large = large.size();
+
+    auto start = std::chrono::steady_clock::now();
+    if (!small.empty()) {
+        uint64_t max_N = small.front()->N;
+        std::vector<std::unique_ptr<ff::ff_node>> W;
+        for (int i = 0; i < nworkers; ++i)
+            W.push_back(std::make_unique<BatchWorker>(max_N));
+        BatchEmitter emitter(small);
+        ff::ff_Farm<> farm(std::move(W), emitter);
+        farm.remove_collector();
+        farm.set_scheduling_ondemand();
+        if (farm.run_and_wait_end() < 0) {
+            ff::error("running batch farm");
+            return stats;
+        }
+    }
+    auto mid = std::chrono::steady_clock::now();
+    std::unique_ptr<WavefrontFarm> farm; // one farm for all the large matrices, frozen between them
+    if (!large.empty())
+        farm = std::make_unique<WavefrontFarm>(nworkers);
+    for (auto instance : large) {
+        Matrix M(instance->N, Row(instance->N, 0.0));
+        init_instance(M, *instance);
+        farm->run(M, instance->N);
+        instance->result = M[0][instance->N - 1];
+    }
+    auto end = std::chrono::steady_clock::now();
+    stats.small_seconds = std::chrono::duration<double>(mid - start).count();
+    stats.large_seconds = std::chrono::duration<double>(end - mid).count();
+    return stats;
+}
+
+#endif // BATCH_WF_HPP
@@ -0,0 +1,291 @@
+#ifndef CHECKPOINT_WF_HPP
+#define CHECKPOINT_WF_HPP
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "matrix_wf.hpp"
+
+// ------------------------------------------------------------------
+// ---------------------- CHECKPOINT / RESTART ----------------------
+// ------------------------------------------------------------------
+// A checkpoint file is a header followed by a list of records, one for each (piece of) diagonal:
+//   header: magic, N, rank, last_diag
+//   record: diag, first_row, count, then the count values M[first_row + k][first_row + k + diag]
+// Records are only appended, so each checkpoint writes just the diagonals completed since the previous one.
+// last_diag is rewritten (and synced) only after the records are on disk: a run killed in the middle
+// of a checkpoint loses the partial batch, never the diagonals already persisted.
+
+struct CheckpointHeader {
+    char magic[8];
+    uint64_t N;
+    uint64_t rank;
+    uint64_t last_diag; // last diagonal whose records are all persisted (0 = nothing but the initial diagonal)
+};
+
+struct CheckpointRecord {
+    uint64_t diag;
+    uint64_t first_row;
+    uint64_t count;
+};
+
+constexpr char CHECKPOINT_MAGIC[8] = {'W', 'F', 'C', 'K', 'P', 'T', '0', '1'};
+
+struct CheckpointConfig {
+    std::string filename;   // empty if checkpointing is disabled
+    double interval = 60.0; // seconds between two checkpoints
+};
+
+inline std::string checkpoint_rank_filename(const std::string &filename, int rank) {
+    std::string rank_filename = filename;
+    rank_filename.append(".").append(std::to_string(rank));
+    return rank_filename;
+}
+
+// checkpointing is enabled with WF_CHECKPOINT=<file> (WF_CHECKPOINT_INTERVAL=<seconds> to change the interval).
+// MPI ranks use one file each: <file>.<rank>
+inline CheckpointConfig checkpoint_config_from_env(int rank = -1) {
+    CheckpointConfig config;
+    if (const char *file = std::getenv("WF_CHECKPOINT"))
+        config.filename = file;
+    if (const char *interval = std::getenv("WF_CHECKPOINT_INTERVAL"))
+        config.interval = std::stod(interval);
+    if (!config.filename.empty() && rank >= 0)
+        config.filename = checkpoint_rank_filename(config.filename, rank);
+    return config;
+}
+
+// returns the last diagonal persisted in the file, 0 if the file does not exist or is for another N
+inline uint64_t checkpoint_last_diag(const std::string &filename, uint64_t N) {
+    CheckpointHeader header;
+    FILE *f = std::fopen(filename.c_str(), "rb");
+    if (f == nullptr) return 0;
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1;
+    std::fclose(f);
+    if (!ok || std::memcmp(header.magic, CHECKPOINT_MAGIC, 8) != 0 || header.N != N) return 0;
+    return header.last_diag;
+}
+
+// loads the records of the file up to min(last_diag, max_diag) into both triangles of M
+// (the kernels read the mirrored lower triangle). Returns the last diagonal loaded.
+template <typename MatrixT>
+uint64_t load_checkpoint(const std::string &filename, MatrixT &M, uint64_t N,
+                                uint64_t max_diag = UINT64_MAX) {
+    uint64_t last_diag = checkpoint_last_diag(filename, N);
+    if (last_diag == 0) return 0;
+    last_diag = std::min(last_diag, max_diag);
+
+    FILE *f = std::fopen(filename.c_str(), "rb");
+    std::fseek(f, sizeof(CheckpointHeader), SEEK_SET);
+    CheckpointRecord record;
+    std::vector<double> values;
+    while (std::fread(&record, sizeof(record), 1, f) == 1 && record.diag <= last_diag) {
+        values.resize(record.count);
+        if (std::fread(values.data(), sizeof(double), record.count, f) != record.count) break;
+        for (uint64_t k = 0; k < record.count; ++k) {
+            auto row = record.first_row + k;
+            M[row][row + record.diag] = values[k];
+            M[row + record.diag][row] = values[k];
+        }
+    }
+    std::fclose(f);
+    return last_diag;
+}
+
+// Writes checkpoints from a background thread, so the computation only pays a clock read per diagonal.
+// Full diagonals (sequential, farm) are read directly from M by the I/O thread: once a diagonal is done
+// nobody writes it again. MPI ranks own just a segment of each diagonal and overwrite old elements with
+// the received rows/columns, so their segments are copied when they complete (O(N/size) per diagonal).
+// MatrixT is anything indexed as M[row][col], such as the node-wide matrix of the MPI shared-memory mode.
+template <typename MatrixT>
+class BasicCheckpointWriter {
+public:
+    BasicCheckpointWriter(const CheckpointConfig &config, MatrixT &M, uint64_t N,
+                     uint64_t last_diag, uint64_t rank = 0)
+        : M(M), N(N), interval(config.interval), persisted_diag(last_diag), pending_diag(last_diag + 1) {
+        // open the file, dropping the records of a batch that was not completed
+        file = std::fopen(config.filename.c_str(), last_diag > 0 ? "r+b" : "w+b");
+        if (file == nullptr) {
+            std::perror(("checkpoint " + config.filename).c_str());
+            return;
+        }
+        if (last_diag == 0) {
+            CheckpointHeader header;
+            std::memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+            header.N = N;
+            header.rank = rank;
+            header.last_diag = 0;
+            std::fwrite(&header, sizeof(header), 1, file);
+        } else {
+            std::fseek(file, sizeof(CheckpointHeader), SEEK_SET);
+            CheckpointRecord record;
+            long valid_end = std::ftell(file);
+            while (std::fread(&record, sizeof(record), 1, file) == 1 && record.diag <= last_diag) {
+                if (std::fseek(file, record.count * sizeof(double), SEEK_CUR) != 0) break;
+                valid_end = std::ftell(file);
+            }
+            std::fflush(file);
+            if (ftruncate(fileno(file), valid_end) != 0) std::perror("checkpoint truncate");
+            // the header may name a later diagonal (MPI restarts from the minimum over the ranks): it must not
+            // outlive the records just dropped, or the next restart would resume past them
+            if (pwrite(fileno(file), &last_diag, sizeof(last_diag), offsetof(CheckpointHeader, last_diag)) < 0)
+                std::perror("checkpoint header");
+            fsync(fileno(file));
+            std::fseek(file, valid_end, SEEK_SET);
+        }
+        last_checkpoint = std::chrono::steady_clock::now();
+        io_thread = std::thread([this] { io_loop(); });
+    }
+
+    ~BasicCheckpointWriter() { finish(); }
+
+    // the whole diagonal diag is final
+    void diagonal_done(uint64_t diag) {
+        if (file == nullptr) return;
+        completed_diag = diag;
+        maybe_checkpoint();
+    }
+
+    // this process computed rows first_row .. first_row+count-1 of diagonal diag (MPI)
+    void segment_done(uint64_t diag, uint64_t first_row, uint64_t count) {
+        if (file == nullptr) return;
+        auto start = std::chrono::steady_clock::now();
+        pending.records.push_back({diag, first_row, count});
+        for (uint64_t row = first_row; row < first_row + count; ++row)
+            pending.values.push_back(M[row][row + diag]);
+        completed_diag = diag;
+        stall_seconds += std::chrono::steady_clock::now() - start;
+        maybe_checkpoint();
+    }
+
+    // waits for the checkpoint in flight and stops the I/O thread. The diagonals completed after the last
+    // checkpoint are not written: the run is over, and the matrix is the result.
+    void finish() {
+        if (!io_thread.joinable()) return;
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_one();
+        io_thread.join();
+        std::fclose(file);
+        stall_seconds += std::chrono::steady_clock::now() - start;
+    }
+
+    void print_stats(double elapsed) const {
+        std::cout << "checkpoint: " << n_checkpoints << " checkpoints, " << bytes_written / (1024.0 * 1024.0)
+                  << " MiB, last diagonal " << persisted_diag << ", background I/O " << io_seconds.count()
+                  << "s, stall " << stall_seconds.count() << "s (" << 100.0 * stall_seconds.count() / elapsed
+                  << "% of the elapsed time)\n";
+    }
+
+private:
+    struct Batch {
+        uint64_t first_diag = 0;
+        uint64_t last_diag = 0;
+        std::vector<CheckpointRecord> records; // empty: full diagonals first_diag..last_diag read from M
+        std::vector<double> values;
+    };
+
+    void maybe_checkpoint() {
+        auto now = std::chrono::steady_clock::now();
+        if (completed_diag < pending_diag || now - last_checkpoint < std::chrono::duration<double>(interval)) return;
+        std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+        if (!lock.owns_lock() || busy) return; // the previous checkpoint is still being written, retry later
+        pending.first_diag = pending_diag;
+        pending.last_diag = completed_diag;
+        std::swap(pending, in_flight);
+        pending = Batch();
+        pending_diag = completed_diag + 1;
+        busy = true;
+        last_checkpoint = now;
+        lock.unlock();
+        cv.notify_one();
+        stall_seconds += std::chrono::steady_clock::now() - now;
+    }
+
+    void io_loop() {
+        std::vector<double> buffer;
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this] { return busy || stop; });
+            if (!busy) return;
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            if (in_flight.records.empty()) {
+                for (uint64_t diag = in_flight.first_diag; diag <= in_flight.last_diag; ++diag) {
+                    buffer.resize(N - diag);
+                    for (uint64_t row = 0; row < N - diag; ++row)
+                        buffer[row] = M[row][row + diag];
+                    write_record({diag, 0, N - diag}, buffer.data());
+                }
+            } else {
+                const double *values = in_flight.values.data();
+                for (auto &record : in_flight.records) {
+                    write_record(record, values);
+                    values += record.count;
+                }
+            }
+            commit(in_flight.last_diag);
+            io_seconds += std::chrono::steady_clock::now() - start;
+            lock.lock();
+            busy = false;
+        }
+    }
+
+    void write_record(const CheckpointRecord &record, const double *values) {
+        std::fwrite(&record, sizeof(record), 1, file);
+        std::fwrite(values, sizeof(double), record.count, file);
+        bytes_written += sizeof(record) + record.count * sizeof(double);
+    }
+
+    // makes the records durable, then publishes them in the header
+    void commit(uint64_t last_diag) {
+        std::fflush(file);
+        fsync(fileno(file));
+        if (pwrite(fileno(file), &last_diag, sizeof(last_diag), offsetof(CheckpointHeader, last_diag)) < 0)
+            std::perror("checkpoint header");
+        fsync(fileno(file));
+        persisted_diag = last_diag;
+        n_checkpoints++;
+    }
+
+    MatrixT &M;
+    uint64_t N;
+    double interval;
+    FILE *file = nullptr;
+
+    uint64_t persisted_diag;
+    uint64_t pending_diag;       // first diagonal not handed to the I/O thread yet
+    uint64_t completed_diag = 0; // last diagonal completed by the computation
+    Batch pending, in_flight;
+    std::chrono::steady_clock::time_point last_checkpoint;
+
+    std::thread io_thread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool busy = false;
+    bool stop = false;
+
+    size_t n_checkpoints = 0;
+    size_t bytes_written = 0;
+    std::chrono::duration<double> io_seconds{0};
+    std::chrono::duration<double> stall_seconds{0};
+};
+
+using CheckpointWriter = BasicCheckpointWriter<Matrix>;
+
+#endif // CHECKPOINT_WF_HPP
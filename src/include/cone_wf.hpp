@@ -0,0 +1,185 @@
+#ifndef CONE_WF_HPP
+#define CONE_WF_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ------------------------------------------------------------------
+// ------------------- DEPENDENCY-CONE QUERIES ----------------------
+// ------------------------------------------------------------------
+// Element (i,j), j > i, is the cube root of the dot product of M[i][i..j-1] and M[i+1..j][j]: it depends only on
+// the triangle of the elements (a,b) with i <= a <= b <= j, its dependency cone, of (j-i+1)(j-i+2)/2 elements and
+// about (j-i)^3/6 multiply-adds. ConeEvaluator computes the union of the cones of the requested elements, diagonal
+// by diagonal (each diagonal in parallel with OpenMP, if compiled with -fopenmp), and keeps what it computed for
+// the next queries. A union of cones is closed downward, so the elements computed so far are described exactly by
+// the list of the largest cones evaluated, and a query only computes what is in its cones and not in that list.
+// The elements are stored in square tiles allocated on first use (both (a,b) and (b,a), as in compute_stencil_optim,
+// so that both operands of the dot product are read along a row): only the tiles crossed by the cones take memory.
+
+// a closed range of rows [first, last]
+using ConeRange = std::pair<uint64_t, uint64_t>;
+
+// sorts and merges overlapping or adjacent ranges
+inline std::vector<ConeRange> merge_ranges(std::vector<ConeRange> ranges) {
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<ConeRange> merged;
+    for (auto &r : ranges) {
+        if (!merged.empty() && r.first <= merged.back().second + 1)
+            merged.back().second = std::max(merged.back().second, r.second);
+        else
+            merged.push_back(r);
+    }
+    return merged;
+}
+
+// the ranges of a (sorted, merged) that are not in b (sorted, merged)
+inline std::vector<ConeRange> subtract_ranges(const std::vector<ConeRange> &a, const std::vector<ConeRange> &b) {
+    std::vector<ConeRange> result;
+    size_t k = 0;
+    for (auto r : a) {
+        uint64_t first = r.first;
+        while (k < b.size() && b[k].second < first) ++k;
+        for (size_t h = k; h < b.size() && b[h].first <= r.second && first <= r.second; ++h) {
+            if (b[h].first > first) result.push_back({first, b[h].first - 1});
+            first = std::max(first, b[h].second + 1);
+        }
+        if (first <= r.second) result.push_back({first, r.second});
+    }
+    return result;
+}
+
+struct ConeStats {
+    uint64_t elements = 0; // elements computed
+    double work = 0;       // multiply-adds
+};
+
+class ConeEvaluator {
+public:
+    static constexpr uint64_t TILE = 64;
+
+    // diagonal(k): the initial value of M[k][k]
+    ConeEvaluator(uint64_t N, std::function<double(uint64_t)> diagonal):
+        N(N), tiles_per_side((N + TILE - 1) / TILE), diagonal(std::move(diagonal)) {}
+
+    // M[i][j] for each requested element, computing the missing part of their cones
+    std::vector<double> query(const std::vector<std::pair<uint64_t, uint64_t>> &elements) {
+        std::vector<ConeRange> cones;
+        for (auto [i, j] : elements)
+            cones.push_back({std::min(i, j), std::max(i, j)});
+        evaluate(cones);
+        std::vector<double> values;
+        for (auto [i, j] : elements)
+            values.push_back(at(i, j));
+        return values;
+    }
+
+    double query(uint64_t i, uint64_t j) { return query({{i, j}})[0]; }
+
+    // total since the evaluator was created
+    const ConeStats &stats() const { return totals; }
+    // stats of the last query
+    const ConeStats &last_stats() const { return last; }
+    size_t allocated_bytes() const { return tiles.size() * TILE * TILE * sizeof(double); }
+
+private:
+    struct Tile {
+        std::unique_ptr<double[]> values{new double[TILE * TILE]};
+    };
+
+    // pointer to element (r,c), whose tile must exist
+    double *element(uint64_t r, uint64_t c) const {
+        return tiles.find(r / TILE * tiles_per_side + c / TILE)->second.values.get() + (r % TILE) * TILE + c % TILE;
+    }
+
+    double at(uint64_t i, uint64_t j) const { return *element(i, j); }
+
+    void ensure_tile(uint64_t r, uint64_t c) {
+        uint64_t key = r / TILE * tiles_per_side + c / TILE;
+        if (tiles.count(key)) return;
+        Tile &tile = tiles[key];
+        if (r / TILE == c / TILE) // a tile on the main diagonal also holds the initial values
+            for (uint64_t k = r / TILE * TILE; k < std::min(N, r / TILE * TILE + TILE); ++k)
+                tile.values[(k % TILE) * TILE + k % TILE] = diagonal(k);
+    }
+
+    // dot product of M[i][i..j-1] and M[j][j..i+1] (the mirror of M[i+1..j][j]), one tile segment at a time
+    double dot(uint64_t i, uint64_t j) const {
+        uint64_t d = j - i;
+        double temp = 0.0;
+        for (uint64_t k = 0; k < d;) {
+            const double *a = element(i, i + k);
+            const double *b = element(j, j - k);
+            uint64_t n = std::min({d - k, TILE - (i + k) % TILE, (j - k) % TILE + 1});
+            for (uint64_t t = 0; t < n; ++t)
+                temp += a[t] * b[-int64_t(t)];
+            k += n;
+        }
+        return temp;
+    }
+
+    void evaluate(const std::vector<ConeRange> &cones) {
+        last = ConeStats();
+        uint64_t max_diag = 0;
+        for (auto [i, j] : cones) {
+            ensure_tile(i, i);
+            ensure_tile(j, j);
+            max_diag = std::max(max_diag, j - i);
+        }
+        for (uint64_t diag = 1; diag <= max_diag; ++diag) {
+            // rows of the elements of this diagonal in the requested cones and not computed yet
+            std::vector<ConeRange> wanted, known;
+            for (auto [i, j] : cones)
+                if (j - i >= diag) wanted.push_back({i, j - diag});
+            for (auto [i, j] : computed)
+                if (j - i >= diag) known.push_back({i, j - diag});
+            auto todo = subtract_ranges(merge_ranges(wanted), merge_ranges(known));
+            for (auto [first, last_row] : todo)
+                for (uint64_t i = first; i <= last_row; ++i) {
+                    ensure_tile(i, i + diag);
+                    ensure_tile(i + diag, i);
+                }
+            // the tiles are all there: the threads only read the map
+            for (auto [first, last_row] : todo) {
+                uint64_t count = last_row - first + 1;
+                #pragma omp parallel for schedule(static) if(count * diag >= (1 << 16))
+                for (uint64_t i = first; i <= last_row; ++i) {
+                    double value = std::cbrt(dot(i, i + diag));
+                    *element(i + diag, i) = value;
+                    *element(i, i + diag) = value;
+                }
+                last.elements += count;
+                last.work += double(count) * diag;
+            }
+        }
+        totals.elements += last.elements;
+        totals.work += last.work;
+        // keep only the largest cones: a cone inside another one adds nothing
+        computed.insert(computed.end(), cones.begin(), cones.end());
+        std::sort(computed.begin(), computed.end(), [](const ConeRange &x, const ConeRange &y) {
+            return x.first != y.first ? x.first < y.first : x.second > y.second;
+        });
+        std::vector<ConeRange> largest;
+        for (auto &c : computed)
+            if (largest.empty() || c.second > largest.back().second)
+                largest.push_back(c);
+        computed = std::move(largest);
+    }
+
+    uint64_t N;
+    uint64_t tiles_per_side;
+    std::function<double(uint64_t)> diagonal;
+    std::unordered_map<uint64_t, Tile> tiles;
+    std::vector<ConeRange> computed; // the cones evaluated so far, none inside another
+    ConeStats totals, last;
+};
+
+#endif // CONE_WF_HPP
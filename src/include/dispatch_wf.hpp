@@ -0,0 +1,317 @@
+#ifndef DISPATCH_WF_HPP
+#define DISPATCH_WF_HPP
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+#include <cstdlib>
+#include "matrix_wf.hpp"
+#include "sequential_wf.hpp"
+#include "farm_wf.hpp"
+#include "farm_block_cyclic.hpp"
+#include "omp_wf.hpp"
+#include "tuning_wf.hpp"
+#include "progress_wf.hpp"
+#include "sync_wf.hpp"
+
+// ------------------------------------------------------------------
+// ------------------------ BACKEND DISPATCH ------------------------
+// ------------------------------------------------------------------
+// compute_wavefront() runs the backend with the lowest predicted time for N on this machine:
+//   sequential:          W(N) / rate                              W(N) = (N^3 - N) / 6 multiply-adds
+//   farm, block_cyclic,  startup + (N-1) * per_diagonal + W(N) / (min(p, hardware threads) * rate)
+//   omp (with -fopenmp)
+// rate is the throughput of compute_stencil_optim; startup (threads, farm setup) and per_diagonal (the feedback
+// round trip or the barrier, plus the imbalance) are fitted from runs of each backend with p workers on two small
+// matrices. The model is calibrated the first time it is needed on a machine, and saved in the cost model file
+// (WF_COST_MODEL_FILE, default ../results/cost_model.txt), one line per machine and backend:
+//   machine backend nworkers startup_seconds per_diagonal_seconds rate
+// The number of workers, chunk size and scheduling of the backend chosen come from the tuning table if autotune
+// was run on this machine, else p = the hardware threads. When p > N-1, the elements of the first diagonal, any
+// backend (even one given explicitly or tuned) falls back to the sequential kernel.
+
+struct WavefrontOptions {
+    std::string backend = "auto"; // auto, sequential, farm, block_cyclic, omp
+    int nworkers = 0;              // 0: tuned value, else hardware threads
+    size_t chunksize = 0;          // block_cyclic, 0: tuned value, else N / (16 * nworkers)
+    bool on_demand = true;         // block_cyclic, when not tuned
+    size_t first_diag = 1;         // > 1 when restarting from a checkpoint
+    std::function<void(size_t)> on_diagonal_done = nullptr;
+    ProgressMonitor *progress = nullptr;
+    SyncMode sync_mode = SyncMode::spin;
+};
+
+struct BackendCost {
+    std::string backend;
+    int nworkers = 1;
+    double startup = 0;      // seconds
+    double per_diagonal = 0; // seconds
+};
+
+struct WavefrontChoice {
+    TuningConfig config;
+    double predicted_seconds = 0;
+    double sequential_seconds = 0; // predicted
+    bool automatic = false;
+    std::string fallback_from;     // the backend replaced by sequential, as it had more workers than N-1
+};
+
+inline double wavefront_work(uint64_t N) {
+    return (double(N) * N * N - N) / 6;
+}
+
+inline std::string cost_model_filename() {
+    if (const char *file = std::getenv("WF_COST_MODEL_FILE"))
+        return file;
+    return "../results/cost_model.txt";
+}
+
+inline int default_workers() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline size_t default_chunksize(uint64_t N, int nworkers) {
+    return std::max<size_t>(1, N / (16 * size_t(nworkers)));
+}
+
+inline std::vector<std::string> available_backends() {
+#ifdef _OPENMP
+    return {"sequential", "farm", "block_cyclic", "omp"};
+#else
+    return {"sequential", "farm", "block_cyclic"};
+#endif
+}
+
+// runs one backend from first_diag on
+inline void run_backend(const TuningConfig &config, Matrix &M, uint64_t N, size_t first_diag = 1,
+                        std::function<void(size_t)> on_diagonal_done = nullptr, ProgressMonitor *progress = nullptr,
+                        SyncMode sync_mode = SyncMode::spin) {
+    if (config.backend == "farm")
+        compute_stencil_par(M, N, config.nworkers, false, first_diag, on_diagonal_done, progress, sync_mode);
+    else if (config.backend == "block_cyclic")
+        block_cyclic::compute_stencil_par(M, N, config.nworkers, config.chunksize, config.on_demand, first_diag,
+                                          on_diagonal_done, progress, sync_mode);
+#ifdef _OPENMP
+    else if (config.backend == "omp" && first_diag == 1) {
+        omp_set_num_threads(config.nworkers);
+        compute_stencil_omp(M, N, progress, on_diagonal_done);
+    }
+#endif
+    else if (first_diag == 1 && !on_diagonal_done && !progress)
+        compute_stencil_optim(M, N);
+    else { // sequential (or OpenMP restarting from a checkpoint), one diagonal at a time
+        for (uint64_t diag = first_diag; diag < N; ++diag) {
+            ProgressTimer timer(progress, 0);
+            compute_diagonal_optim(M, N, diag);
+            timer.stop();
+            if (on_diagonal_done) on_diagonal_done(diag);
+            if (progress) progress->diagonal_done(diag);
+        }
+    }
+}
+
+class CostModel {
+public:
+    // the saved model of this machine, calibrated now if there is none
+    static CostModel load_or_calibrate(int nworkers) {
+        CostModel model;
+        if (model.load(nworkers)) return model;
+        std::cout << "calibrating the cost model for " << machine_key() << " with " << nworkers << " workers..." << std::endl;
+        model.calibrate(nworkers);
+        if (!model.save())
+            std::cout << "Warning: cannot save the cost model to " << cost_model_filename() << std::endl;
+        return model;
+    }
+
+    double predict(const std::string &backend, uint64_t N) const {
+        if (backend == "sequential") return wavefront_work(N) / rate;
+        for (auto &cost : costs)
+            if (cost.backend == backend)
+                return cost.startup + double(N - 1) * cost.per_diagonal + wavefront_work(N) / (parallelism(cost.nworkers) * rate);
+        return -1; // not calibrated
+    }
+
+    // the backend with the lowest predicted time
+    std::string best(uint64_t N) const {
+        std::string best_backend = "sequential";
+        for (auto &cost : costs)
+            if (predict(cost.backend, N) < predict(best_backend, N))
+                best_backend = cost.backend;
+        return best_backend;
+    }
+
+    void print() const {
+        std::cout << "cost model: sequential " << rate * 1e-9 << " G multiply-adds/s";
+        for (auto &cost : costs)
+            std::cout << "; " << cost.backend << " (" << cost.nworkers << " workers) startup " << cost.startup * 1e6
+                      << "us, " << cost.per_diagonal * 1e6 << "us per diagonal";
+        std::cout << std::endl;
+    }
+
+private:
+    // workers beyond the hardware threads do not compute at the same time
+    static double parallelism(int nworkers) { return std::min(nworkers, default_workers()); }
+
+    // fastest of a few runs of a backend on a fresh matrix of size N
+    static double measure(const TuningConfig &config, uint64_t N, int repetitions) {
+        Matrix M(N, Row(N, 0.0));
+        double best = 0;
+        for (int r = 0; r < repetitions; ++r) {
+            for (uint64_t i = 0; i < N; ++i) // the kernels overwrite everything else
+                M[i][i] = double(i + 1) / double(N);
+            auto start = std::chrono::steady_clock::now();
+            run_backend(config, M, N);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (r == 0 || elapsed.count() < best) best = elapsed.count();
+        }
+        return best;
+    }
+
+    void calibrate(int nworkers) {
+        constexpr uint64_t SMALL = 128, LARGE = 512;
+        TuningConfig sequential{"sequential"};
+        rate = wavefront_work(LARGE) / measure(sequential, LARGE, 3);
+        costs.clear();
+        for (auto &backend : available_backends()) {
+            if (backend == "sequential") continue;
+            BackendCost cost{backend, nworkers};
+            TuningConfig config{backend, nworkers, default_chunksize(LARGE, nworkers), true};
+            // the time left after the ideal parallel computation is startup + (N-1) * per_diagonal
+            double small = measure(config, SMALL, 5) - wavefront_work(SMALL) / (parallelism(nworkers) * rate);
+            double large = measure(config, LARGE, 3) - wavefront_work(LARGE) / (parallelism(nworkers) * rate);
+            cost.per_diagonal = std::max(0.0, (large - small) / double(LARGE - SMALL));
+            cost.startup = small - double(SMALL - 1) * cost.per_diagonal;
+            if (cost.startup < 0) {
+                cost.startup = 0;
+                cost.per_diagonal = std::max(0.0, large / double(LARGE - 1));
+            }
+            costs.push_back(cost);
+        }
+    }
+
+    bool load(int nworkers) {
+        std::ifstream file(cost_model_filename());
+        auto machine = machine_key();
+        auto backends = available_backends();
+        std::string line;
+        costs.clear();
+        rate = 0;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream fields(line);
+            std::string entry_machine;
+            BackendCost cost;
+            double entry_rate;
+            if (!(fields >> entry_machine >> cost.backend >> cost.nworkers >> cost.startup >> cost.per_diagonal >> entry_rate)) continue;
+            if (entry_machine != machine) continue;
+            if (cost.backend == "sequential")
+                rate = entry_rate;
+            else if (cost.nworkers == nworkers && std::count(backends.begin(), backends.end(), cost.backend))
+                costs.push_back(cost);
+        }
+        return rate > 0 && costs.size() + 1 == backends.size();
+    }
+
+    // replaces the lines of this machine (and these workers) in the file
+    bool save() const {
+        auto machine = machine_key();
+        std::vector<std::string> lines;
+        {
+            std::ifstream file(cost_model_filename());
+            std::string line;
+            while (std::getline(file, line)) {
+                std::istringstream fields(line);
+                std::string entry_machine, backend;
+                int workers = 0;
+                fields >> entry_machine >> backend >> workers;
+                bool replaced = entry_machine == machine && (backend == "sequential" || workers == nworkers());
+                if (!line.empty() && line[0] != '#' && !replaced) lines.push_back(line);
+            }
+        }
+        std::error_code error;
+        auto path = std::filesystem::path(cost_model_filename());
+        if (path.has_parent_path())
+            std::filesystem::create_directories(path.parent_path(), error);
+        std::ofstream file(cost_model_filename());
+        if (!file.is_open()) return false;
+        file << "# machine backend nworkers startup_seconds per_diagonal_seconds rate\n";
+        for (auto &line : lines) file << line << "\n";
+        file << machine << " sequential 1 0 0 " << rate << "\n";
+        for (auto &cost : costs)
+            file << machine << " " << cost.backend << " " << cost.nworkers << " " << cost.startup << " " << cost.per_diagonal << " "
+                 << rate << "\n";
+        return bool(file);
+    }
+
+    int nworkers() const { return costs.empty() ? 1 : costs.front().nworkers; }
+
+    double rate = 0; // multiply-adds per second of the sequential kernel
+    std::vector<BackendCost> costs;
+};
+
+// chooses the backend (unless options.backend says which) and its parameters, without running it.
+// model: a cost model already loaded (for callers that choose many times), else it is loaded here
+inline WavefrontChoice choose_backend(uint64_t N, const WavefrontOptions &options = WavefrontOptions(),
+                                      const CostModel *model = nullptr) {
+    WavefrontChoice choice;
+    int nworkers = options.nworkers > 0 ? options.nworkers : default_workers();
+    choice.config.backend = options.backend;
+    if (options.backend == "auto") {
+        CostModel loaded;
+        if (model == nullptr) {
+            loaded = CostModel::load_or_calibrate(nworkers);
+            model = &loaded;
+        }
+        choice.automatic = true;
+        choice.config.backend = model->best(N);
+        choice.predicted_seconds = model->predict(choice.config.backend, N);
+        choice.sequential_seconds = model->predict("sequential", N);
+    }
+    TuningConfig tuned;
+    if (options.nworkers == 0 && lookup_tuning(N, tuned, choice.config.backend))
+        choice.config = tuned;
+    else {
+        choice.config.nworkers = choice.config.backend == "sequential" ? 1 : nworkers;
+        choice.config.chunksize = options.chunksize > 0 ? options.chunksize : default_chunksize(N, nworkers);
+        choice.config.on_demand = options.on_demand;
+    }
+    // workers beyond the N-1 elements of the first diagonal have nothing to do on any diagonal, and the
+    // parallel backends would only add their synchronization to the sequential time
+    if (choice.config.backend != "sequential" && N - 1 < uint64_t(choice.config.nworkers)) {
+        choice.fallback_from = choice.config.backend;
+        choice.config.backend = "sequential";
+        choice.config.nworkers = 1;
+        choice.predicted_seconds = choice.sequential_seconds;
+    }
+    return choice;
+}
+
+inline void print_choice(const WavefrontChoice &choice) {
+    std::cout << "backend: " << choice.config.backend;
+    if (choice.config.backend != "sequential") std::cout << ", " << choice.config.nworkers << " workers";
+    if (choice.config.backend == "block_cyclic")
+        std::cout << ", chunksize " << choice.config.chunksize << (choice.config.on_demand ? ", on demand" : ", round robin");
+    if (!choice.fallback_from.empty())
+        std::cout << " (instead of " << choice.fallback_from << ": more workers than the elements of the first diagonal)";
+    if (choice.automatic)
+        std::cout << " (chosen by the cost model: predicted " << choice.predicted_seconds << "s, sequential "
+                  << choice.sequential_seconds << "s)";
+    std::cout << std::endl;
+}
+
+// computes the wavefront of M with the best backend for N (or options.backend), and returns the choice made
+inline WavefrontChoice compute_wavefront(Matrix &M, uint64_t N, const WavefrontOptions &options = WavefrontOptions()) {
+    auto choice = choose_backend(N, options);
+    run_backend(choice.config, M, N, options.first_diag, options.on_diagonal_done, options.progress, options.sync_mode);
+    return choice;
+}
+
+#endif // DISPATCH_WF_HPP
@@ -1,5 +1,5 @@
-#ifndef STENCIL_HPP
-#define STENCIL_HPP
+#ifndef FARM_BLOCK_CYCLIC_HPP
+#define FARM_BLOCK_CYCLIC_HPP
 
 #include <iostream>
 #include <vector>
@@ -8,10 +8,17 @@
 #include <ff/farm.hpp>
 #include <ff/utils.hpp>
 #include <chrono>
+#include <functional>
+#include "matrix_wf.hpp"
+#include "progress_wf.hpp"
+#include "sync_wf.hpp"
 
 // ------------------------------------------------------------------
 // ---------------------- FARM IMPLEMENTATION -----------------------
 // ------------------------------------------------------------------
+// in its own namespace, so it can be used together with the farm in farm_wf.hpp
+namespace block_cyclic {
+
 struct Task {
     size_t diag;
     size_t row;
@@ -21,7 +28,7 @@ struct Task {
 
 void inline compute_stencil_one_chunk(
     // Function used by the workers in the farm, computes a piece of the wavefront.
-    std::vector<std::vector<double>> &M,
+    Matrix &M,
     const uint64_t &N,
     const uint64_t &diag,
     uint64_t &row,
@@ -45,19 +52,31 @@ void inline compute_stencil_one_chunk(
 }
 
 struct Emitter: ff::ff_monode_t<bool, Task>{
-    Emitter(std::vector<std::vector<double>> &M, size_t N, int n_workers,  size_t chunksize = 1):M(M), N(N), n_workers(n_workers), chunksize(chunksize) {}
-    size_t diag =1;
+    Emitter(Matrix &M, size_t N, int n_workers,  size_t chunksize = 1, size_t first_diag = 1, FarmSync *sync = nullptr):
+        M(&M), N(N), n_workers(n_workers), chunksize(std::max<size_t>(1, chunksize)), diag(first_diag), sync(sync) {}
     double total_time;
 
+    // next job of a frozen farm (see WavefrontFarm)
+    void reset(Matrix &M, size_t N, size_t chunksize, size_t first_diag) {
+        this->M = &M;
+        this->N = N;
+        this->chunksize = std::max<size_t>(1, chunksize); // a chunk of 0 rows would never reach the end of the diagonal
+        diag = first_diag;
+    }
+
     Task* svc(bool *diagonal_is_done){
         // send the tasks to the workers
         if( n_workers * chunksize > N - diag){
-            chunksize = N / n_workers; // if the chunksize is too big, we reduce it
+            chunksize = std::max<size_t>(1, N / n_workers); // if the chunksize is too big, we reduce it (N < n_workers: 1)
         }
 
         if(diagonal_is_done!=nullptr){
             *diagonal_is_done = false; // reset the signal received by the collector
         }
+        if(sync) {
+            sync->tasks.value.store((N - diag + chunksize - 1) / chunksize, std::memory_order_relaxed);
+            sync->started.value.store(0, std::memory_order_release);
+        }
         
         for(uint64_t row = 0; row< (N- diag); row += chunksize){      // for each elem. in the diagonal
             size_t block_size = std::min( N-diag-row, chunksize); // the last chunk might be smaller
@@ -68,62 +87,119 @@ struct Emitter: ff::ff_monode_t<bool, Task>{
         }
         diag++;
         if (diag == N) return EOS;
+        if (sync) { // adaptive mode: spin for a while before sleeping until the feedback of the collector
+            sync->dispatched.value.store(diag - 1, std::memory_order_release);
+            spin.wait([&] { return sync->completed.value.load(std::memory_order_acquire) >= diag - 1; });
+        }
         return GO_ON;
     }
 
 
-    std::vector<std::vector<double>> &M;
+    Matrix *M;
     size_t N;
     int n_workers;
     size_t chunksize;
+    size_t diag;
+    FarmSync *sync;
+    AdaptiveSpin spin;
 };
 
 struct Worker: ff::ff_node_t<Task, Task> {
-    std::vector<std::vector<double>> &M;
+    Matrix *M;
     size_t N;
-    Worker(std::vector<std::vector<double>> &M, size_t N): M(M), N(N) {}
+    ProgressMonitor *progress;
+    FarmSync *sync;
+    AdaptiveSpin spin;
+    Worker(Matrix &M, size_t N, ProgressMonitor *progress = nullptr, FarmSync *sync = nullptr): M(&M), N(N), progress(progress), sync(sync) {}
+    void reset(Matrix &M, size_t N, ProgressMonitor *progress) {
+        this->M = &M;
+        this->N = N;
+        this->progress = progress;
+    }
     Task* svc(Task *task) {
-        compute_stencil_one_chunk(M, N, task->diag, task->row, task->chunksize);
-        return task;
+        size_t diag = task->diag;
+        if (sync) sync->started.value.fetch_add(1, std::memory_order_acq_rel);
+        {
+            ProgressTimer timer(progress, get_my_id());
+            block_cyclic::compute_stencil_one_chunk(*M, N, task->diag, task->row, task->chunksize);
+        }
+        if (!sync) return task;
+        // adaptive mode: send the result; once all the tasks of the diagonal are taken no other task can come
+        // before the next diagonal, so spin for a while before sleeping
+        ff_send_out(task);
+        sync->results.value.fetch_add(1, std::memory_order_release);
+        if (diag < N - 1 && sync->started.value.load(std::memory_order_acquire) >= sync->tasks.value.load(std::memory_order_relaxed))
+            spin.wait([&] { return sync->dispatched.value.load(std::memory_order_acquire) > diag; });
+        return GO_ON;
     }
 };
 
 struct Collector: ff::ff_minode_t<Task, bool> {
-    Collector(size_t N): N(N) {}
+    Collector(size_t N, size_t first_diag = 1, std::function<void(size_t)> on_diagonal_done = nullptr,
+              ProgressMonitor *progress = nullptr, FarmSync *sync = nullptr):
+        N(N), diag(first_diag), on_diagonal_done(on_diagonal_done), progress(progress), sync(sync) {}
+    void reset(size_t N, size_t first_diag, std::function<void(size_t)> on_diagonal_done, ProgressMonitor *progress) {
+        this->N = N;
+        diag = first_diag;
+        this->on_diagonal_done = on_diagonal_done;
+        this->progress = progress;
+        done = 0;
+        received = 0;
+    }
     bool* svc(Task *computed) {
         done += computed->chunksize; // update the number of elements computed
+        received += 1;
         delete computed;
         if(done == N-diag) { // if the diagonal is all done
             done = 0;
+            if(on_diagonal_done) on_diagonal_done(diag);
+            if(progress) progress->diagonal_done(diag);
+            if(sync) sync->completed.value.store(diag, std::memory_order_release);
             diag++;
             diagonal_is_done = true;
             return &diagonal_is_done; // send the signal to the emitter
 
         }
+        if(sync) // adaptive mode: spin for a while before sleeping until the next result
+            spin.wait([&] { return sync->results.value.load(std::memory_order_acquire) > received; });
         return GO_ON; // else do nothing and keep going
     }
 
 
     size_t done = 0;
     size_t N;
-    size_t diag = 1;
+    size_t diag;
     bool diagonal_is_done = false;
+    std::function<void(size_t)> on_diagonal_done; // called by the collector when a diagonal is final
+    ProgressMonitor *progress;
+    FarmSync *sync;
+    AdaptiveSpin spin;
+    size_t received = 0;
 };
 
 
-void compute_stencil_par(std::vector<std::vector<double>> &M, const uint64_t &N, int nworkers, size_t chunksize, bool on_demand=true) {
+// first_diag > 1 resumes a computation whose diagonals up to first_diag-1 are already in M
+void compute_stencil_par(Matrix &M, const uint64_t &N, int nworkers, size_t chunksize, bool on_demand=true,
+                         size_t first_diag = 1, std::function<void(size_t)> on_diagonal_done = nullptr,
+                         ProgressMonitor *progress = nullptr, SyncMode sync_mode = SyncMode::spin) {
+    if(first_diag >= N) return; // nothing left to compute
+    std::unique_ptr<FarmSync> sync;
+    if(sync_mode == SyncMode::adaptive)
+        sync = std::make_unique<FarmSync>();
     auto make_farm = [&]() {
         std::vector<std::unique_ptr<ff::ff_node>> W;
         for(auto i = 0; i < nworkers; ++i)
-            W.push_back(std::make_unique<Worker>(M, N));
+            W.push_back(std::make_unique<Worker>(M, N, progress, sync.get()));
         return W;
     };
-    Emitter emitter(M, N, nworkers, chunksize);
-    Collector collector(N);
+    Emitter emitter(M, N, nworkers, chunksize, first_diag, sync.get());
+    Collector collector(N, first_diag, on_diagonal_done, progress, sync.get());
     ff::ff_Farm<> farm(std::move(make_farm()), emitter, collector);
     farm.wrap_around();
     if(on_demand) 
         farm.set_scheduling_ondemand();
+    if(sync_mode != SyncMode::spin)
+        farm.blocking_mode(true); // idle threads sleep instead of busy-waiting on their queues
 
       
     if(farm.run_and_wait_end() < 0) {
@@ -132,4 +208,60 @@ void compute_stencil_par(std::vector<std::vector<double>> &M, const uint64_t &N,
     }
 }
 
-#endif // STENCIL_HPP
+// the block-cyclic farm built once and run for any number of jobs, see WavefrontFarm in farm_wf.hpp
+class WavefrontFarm {
+public:
+    WavefrontFarm(int nworkers, bool on_demand = true, SyncMode sync_mode = SyncMode::spin):
+        emitter(none, 0, nworkers), collector(0) {
+        if(sync_mode == SyncMode::adaptive)
+            sync = std::make_unique<FarmSync>();
+        emitter.sync = sync.get();
+        collector.sync = sync.get();
+        std::vector<std::unique_ptr<ff::ff_node>> W;
+        for(auto i = 0; i < nworkers; ++i) {
+            auto worker = std::make_unique<Worker>(none, 0, nullptr, sync.get());
+            workers.push_back(worker.get());
+            W.push_back(std::move(worker));
+        }
+        farm = std::make_unique<ff::ff_Farm<>>(std::move(W), emitter, collector);
+        farm->wrap_around();
+        if(on_demand)
+            farm->set_scheduling_ondemand();
+        if(sync_mode != SyncMode::spin)
+            farm->blocking_mode(true);
+    }
+
+    ~WavefrontFarm() {
+        if(jobs > 0) farm->wait(); // thaws the frozen threads so that they terminate
+    }
+
+    // computes the wavefront of M, like compute_stencil_par; false if the farm cannot run
+    bool run(Matrix &M, uint64_t N, size_t chunksize, size_t first_diag = 1,
+             std::function<void(size_t)> on_diagonal_done = nullptr, ProgressMonitor *progress = nullptr) {
+        if(first_diag >= N) return true;
+        emitter.reset(M, N, chunksize, first_diag); // the emitter shrinks the chunks of the last diagonals
+        for(auto worker : workers)
+            worker->reset(M, N, progress);
+        collector.reset(N, first_diag, on_diagonal_done, progress);
+        if(sync) sync->reset();
+        if(farm->run_then_freeze() < 0 || farm->wait_freezing() < 0) {
+            ff::error("running farm");
+            return false;
+        }
+        jobs++;
+        return true;
+    }
+
+private:
+    Matrix none; // the nodes need a matrix before the first job
+    std::unique_ptr<FarmSync> sync;
+    Emitter emitter;
+    Collector collector;
+    std::vector<Worker *> workers; // owned by the farm
+    std::unique_ptr<ff::ff_Farm<>> farm;
+    size_t jobs = 0;
+};
+
+} // namespace block_cyclic
+
+#endif // FARM_BLOCK_CYCLIC_HPP
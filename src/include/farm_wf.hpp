@@ -11,6 +11,13 @@
 #include <ff/node.hpp>
 #include <chrono>
 #include <utility>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "matrix_wf.hpp"
+#include "progress_wf.hpp"
+#include "sync_wf.hpp"
 
 
 
@@ -30,7 +37,7 @@ std::pair<size_t, size_t> compute_start_end(const size_t &N, size_t worker_id, s
 
 void inline compute_stencil_one_chunk(
     // Function used by the workers in the farm, computes a piece of the wavefront.
-    std::vector<std::vector<double>> &M,
+    Matrix &M,
     const uint64_t &N,
     const uint64_t &diag,
     uint64_t &row,
@@ -54,8 +61,15 @@ void inline compute_stencil_one_chunk(
 
 // emitter node: it sends the diagonal to the workers, and synchronizes the computation
 struct Emitter: ff::ff_monode_t<bool, size_t>{
-    Emitter(std::vector<std::vector<double>> &M, size_t N, int n_workers):M(M), N(N), n_workers(n_workers) {}
-    size_t diag =0;
+    Emitter(Matrix &M, size_t N, int n_workers, size_t first_diag = 1, FarmSync *sync = nullptr):
+        M(&M), N(N), n_workers(n_workers), diag(first_diag - 1), sync(sync) {}
+
+    // next job of a frozen farm (see WavefrontFarm)
+    void reset(Matrix &M, size_t N, size_t first_diag) {
+        this->M = &M;
+        this->N = N;
+        diag = first_diag - 1;
+    }
 
     size_t* svc(bool *diagonal_is_done){
 
@@ -69,65 +83,121 @@ struct Emitter: ff::ff_monode_t<bool, size_t>{
             ff_send_out(&diag); // send the current diagonal to the workers
         }
         if (diag == N -1) return EOS;
+        if (sync) { // adaptive mode: spin for a while before sleeping until the feedback of the collector
+            sync->dispatched.value.store(diag, std::memory_order_release);
+            spin.wait([&] { return sync->completed.value.load(std::memory_order_acquire) >= diag; });
+        }
         return GO_ON;
     }
 
 
-    std::vector<std::vector<double>> &M;
+    Matrix *M;
     size_t N;
     int n_workers;
+    size_t diag;
+    FarmSync *sync;
+    AdaptiveSpin spin;
 };
 
 
 struct Worker: ff::ff_node_t<size_t, int> {
-    std::vector<std::vector<double>> &M;
+    Matrix *M;
     size_t N;
     int n_workers;
     std::chrono::duration<double> elapsed_seconds;
-    Worker(std::vector<std::vector<double>> &M, size_t N, int n_workers): M(M), N(N), n_workers(n_workers) {}
-    int* svc(size_t *diag)  {
-        auto block = compute_start_end( N - *diag, get_my_id(), n_workers); // get the block of elements to compute
-        compute_stencil_one_chunk(M, N, *diag, block.first, block.second - block.first + 1);
-        return new int{1};
+    ProgressMonitor *progress;
+    FarmSync *sync;
+    AdaptiveSpin spin;
+    Worker(Matrix &M, size_t N, int n_workers, ProgressMonitor *progress = nullptr, FarmSync *sync = nullptr):
+        M(&M), N(N), n_workers(n_workers), progress(progress), sync(sync) {}
+    void reset(Matrix &M, size_t N, ProgressMonitor *progress) {
+        this->M = &M;
+        this->N = N;
+        this->progress = progress;
+    }
+    int* svc(size_t *diag_ptr)  {
+        size_t diag = *diag_ptr; // the emitter moves on to the next diagonal as soon as this one is complete
+        {
+            ProgressTimer timer(progress, get_my_id());
+            auto block = compute_start_end( N - diag, get_my_id(), n_workers); // get the block of elements to compute
+            compute_stencil_one_chunk(*M, N, diag, block.first, block.second - block.first + 1);
+        }
+        if (!sync) return new int{1};
+        // adaptive mode: send the result, then spin for a while before sleeping until the next diagonal
+        ff_send_out(new int{1});
+        sync->results.value.fetch_add(1, std::memory_order_release);
+        if (diag < N - 1)
+            spin.wait([&] { return sync->dispatched.value.load(std::memory_order_acquire) > diag; });
+        return GO_ON;
     }
 };
 
 // collector node: it waits for all the workers to finish computing the elements in the diagonal
 struct Collector: ff::ff_minode_t<int, bool> {
     std::chrono::duration<double> elapsed_seconds;
-    Collector(size_t N, int n_workers): N(N), n_workers(n_workers) {}
+    Collector(size_t N, int n_workers, size_t first_diag = 1, std::function<void(size_t)> on_diagonal_done = nullptr,
+              ProgressMonitor *progress = nullptr, FarmSync *sync = nullptr):
+        N(N), diag(first_diag), n_workers(n_workers), on_diagonal_done(on_diagonal_done), progress(progress), sync(sync) {}
+    void reset(size_t N, size_t first_diag, std::function<void(size_t)> on_diagonal_done, ProgressMonitor *progress) {
+        this->N = N;
+        diag = first_diag;
+        this->on_diagonal_done = on_diagonal_done;
+        this->progress = progress;
+        done = 0;
+        received = 0;
+    }
     bool* svc(int *computed) {
         done += 1; // update the number of elements computed
+        received += 1;
         delete computed;
         if(done == n_workers ) { // if the diagonal is all done
             done = 0;
+            if(on_diagonal_done) on_diagonal_done(diag);
+            if(progress) progress->diagonal_done(diag);
+            if(sync) sync->completed.value.store(diag, std::memory_order_release);
             diag++;
             diagonal_is_done = true;
             return &diagonal_is_done; // send the signal to the emitter
         }
+        if(sync) // adaptive mode: spin for a while before sleeping until the next result
+            spin.wait([&] { return sync->results.value.load(std::memory_order_acquire) > received; });
         return GO_ON; // else do nothing and keep going
     }
     int done = 0;
     size_t N;
-    size_t diag = 1;
+    size_t diag;
     bool diagonal_is_done = false;
     int n_workers;
+    std::function<void(size_t)> on_diagonal_done; // called by the collector when a diagonal is final
+    ProgressMonitor *progress;
+    FarmSync *sync;
+    AdaptiveSpin spin;
+    size_t received = 0;
 };
 
 // parallel version of the stencil computation using a farm(emitter, worker(s), collector)
-void compute_stencil_par(std::vector<std::vector<double>> &M, const uint64_t &N, int nworkers, bool on_demand=false) {
+// first_diag > 1 resumes a computation whose diagonals up to first_diag-1 are already in M
+void compute_stencil_par(Matrix &M, const uint64_t &N, int nworkers, bool on_demand=false,
+                         size_t first_diag = 1, std::function<void(size_t)> on_diagonal_done = nullptr,
+                         ProgressMonitor *progress = nullptr, SyncMode sync_mode = SyncMode::spin) {
+    if(first_diag >= N) return; // nothing left to compute
+    std::unique_ptr<FarmSync> sync;
+    if(sync_mode == SyncMode::adaptive)
+        sync = std::make_unique<FarmSync>();
     auto make_farm = [&]() { // create the farm workers vector
         std::vector<std::unique_ptr<ff::ff_node>> W;
         for(auto i = 0; i < nworkers; ++i)
-            W.push_back(std::make_unique<Worker>(M, N, nworkers));
+            W.push_back(std::make_unique<Worker>(M, N, nworkers, progress, sync.get()));
         return W;
     };
-    Emitter emitter(M, N, nworkers);
-    Collector collector(N, nworkers);
+    Emitter emitter(M, N, nworkers, first_diag, sync.get());
+    Collector collector(N, nworkers, first_diag, on_diagonal_done, progress, sync.get());
     ff::ff_Farm<> farm(std::move(make_farm()), emitter, collector);
     farm.wrap_around(); // backward connection from collector to emitter
     if(on_demand) 
         farm.set_scheduling_ondemand();
+    if(sync_mode != SyncMode::spin)
+        farm.blocking_mode(true); // idle threads sleep instead of busy-waiting on their queues
 
     if(farm.run_and_wait_end() < 0) {
         ff::error("running farm");
@@ -136,4 +206,178 @@ void compute_stencil_par(std::vector<std::vector<double>> &M, const uint64_t &N,
 
 }
 
+// The same farm, built once and run for any number of jobs (matrices of any size). Between two jobs the threads
+// are frozen by FastFlow instead of being joined, so a job does not pay for creating and mapping them again.
+class WavefrontFarm {
+public:
+    WavefrontFarm(int nworkers, bool on_demand = false, SyncMode sync_mode = SyncMode::spin):
+        emitter(none, 0, nworkers), collector(0, nworkers) {
+        if(sync_mode == SyncMode::adaptive)
+            sync = std::make_unique<FarmSync>();
+        emitter.sync = sync.get();
+        collector.sync = sync.get();
+        std::vector<std::unique_ptr<ff::ff_node>> W;
+        for(auto i = 0; i < nworkers; ++i) {
+            auto worker = std::make_unique<Worker>(none, 0, nworkers, nullptr, sync.get());
+            workers.push_back(worker.get());
+            W.push_back(std::move(worker));
+        }
+        farm = std::make_unique<ff::ff_Farm<>>(std::move(W), emitter, collector);
+        farm->wrap_around();
+        if(on_demand)
+            farm->set_scheduling_ondemand();
+        if(sync_mode != SyncMode::spin)
+            farm->blocking_mode(true);
+    }
+
+    ~WavefrontFarm() {
+        if(jobs > 0) farm->wait(); // thaws the frozen threads so that they terminate
+    }
+
+    // computes the wavefront of M, like compute_stencil_par; false if the farm cannot run
+    bool run(Matrix &M, uint64_t N, size_t first_diag = 1, std::function<void(size_t)> on_diagonal_done = nullptr,
+             ProgressMonitor *progress = nullptr) {
+        if(first_diag >= N) return true;
+        // the threads are frozen (or not started yet): the nodes can be changed without synchronization
+        emitter.reset(M, N, first_diag);
+        for(auto worker : workers)
+            worker->reset(M, N, progress);
+        collector.reset(N, first_diag, on_diagonal_done, progress);
+        if(sync) sync->reset();
+        if(farm->run_then_freeze() < 0 || farm->wait_freezing() < 0) {
+            ff::error("running farm");
+            return false;
+        }
+        jobs++;
+        return true;
+    }
+
+private:
+    Matrix none; // the nodes need a matrix before the first job
+    std::unique_ptr<FarmSync> sync;
+    Emitter emitter;
+    Collector collector;
+    std::vector<Worker *> workers; // owned by the farm
+    std::unique_ptr<ff::ff_Farm<>> farm;
+    size_t jobs = 0;
+};
+
+// ------------------------------------------------------------------
+// ------------- FUSED SUPERSTEPS (k diagonals per round trip) ------
+// ------------------------------------------------------------------
+// Each worker advances k diagonals inside its block of rows before going through the collector.
+// At diagonal d+t of a superstep starting at diagonal d, the rows start..end-t of the block (a trapezoid) only
+// depend on the block itself and on the previous supersteps. The remaining rows end-t+1..end (a triangle of
+// k(k-1)/2 elements at the bottom of the block) also need the columns computed by the next worker in its
+// trapezoid: the next worker signals it with a flag, and the triangle is completed without a round trip.
+// This is correct as long as every block has at least k-1 rows, so k shrinks on the last (short) diagonals.
+
+struct Superstep {
+    size_t first_diag;
+    size_t k;     // number of diagonals
+    size_t index; // number of the superstep, used for the flags between neighbours
+};
+
+inline size_t superstep_length(size_t N, size_t diag, size_t k, int n_workers) {
+    return std::max<size_t>(1, std::min({k, (N - diag) / n_workers + 1, N - diag}));
+}
+
+struct FusedEmitter: ff::ff_monode_t<bool, Superstep>{
+    FusedEmitter(size_t N, int n_workers, size_t k, size_t first_diag = 1): N(N), n_workers(n_workers), k(k), diag(first_diag) {}
+
+    Superstep* svc(bool *superstep_is_done){
+        if(superstep_is_done!=nullptr){
+            *superstep_is_done = false; // reset the signal received by the collector
+        }
+        step = {diag, superstep_length(N, diag, k, n_workers), n_steps++};
+        for(int nw = 0; nw < n_workers; nw ++){
+            ff_send_out(&step); // the workers only read it, and it changes only after they are all done
+        }
+        diag += step.k;
+        if (diag >= N) return EOS;
+        return GO_ON;
+    }
+
+    size_t N;
+    int n_workers;
+    size_t k;
+    size_t diag;
+    size_t n_steps = 0;
+    Superstep step;
+};
+
+struct FusedWorker: ff::ff_node_t<Superstep> {
+    Matrix &M;
+    size_t N;
+    int n_workers;
+    std::vector<std::atomic<size_t>> &trapezoid_done; // number of supersteps whose trapezoid is done, per worker
+    FusedWorker(Matrix &M, size_t N, int n_workers, std::vector<std::atomic<size_t>> &trapezoid_done):
+        M(M), N(N), n_workers(n_workers), trapezoid_done(trapezoid_done) {}
+
+    Superstep* svc(Superstep *step) {
+        size_t id = get_my_id();
+        auto block = compute_start_end(N - step->first_diag, id, n_workers);
+        size_t rows = block.second + 1 - block.first; // 0 if the block is empty
+        // trapezoid: shrinks by one row at the bottom for each diagonal
+        for(size_t t = 0; t < step->k && t < rows; ++t) {
+            size_t row = block.first;
+            compute_stencil_one_chunk(M, N, step->first_diag + t, row, rows - t);
+        }
+        trapezoid_done[id].store(step->index + 1, std::memory_order_release);
+
+        // triangle: the last worker has none, its trapezoid already reaches the end of the diagonals
+        if(id + 1 == size_t(n_workers) || step->k == 1 || rows == 0) return step;
+        while(trapezoid_done[id + 1].load(std::memory_order_acquire) <= step->index)
+            std::this_thread::yield();
+        for(size_t t = 1; t < step->k; ++t) {
+            size_t row = block.first + (rows > t ? rows - t : 0);
+            compute_stencil_one_chunk(M, N, step->first_diag + t, row, block.first + rows - row);
+        }
+        return step;
+    }
+};
+
+struct FusedCollector: ff::ff_minode_t<Superstep, bool> {
+    FusedCollector(int n_workers, std::function<void(size_t)> on_diagonal_done = nullptr):
+        n_workers(n_workers), on_diagonal_done(on_diagonal_done) {}
+    bool* svc(Superstep *step) {
+        if(++done < n_workers) return GO_ON;
+        done = 0;
+        if(on_diagonal_done)
+            for(size_t diag = step->first_diag; diag < step->first_diag + step->k; ++diag)
+                on_diagonal_done(diag);
+        superstep_is_done = true;
+        return &superstep_is_done; // send the signal to the emitter
+    }
+    int n_workers;
+    int done = 0;
+    bool superstep_is_done = false;
+    std::function<void(size_t)> on_diagonal_done;
+};
+
+// like compute_stencil_par, but each round trip through the emitter and the collector computes up to k diagonals.
+// Returns the number of round trips (supersteps)
+size_t compute_stencil_par_fused(Matrix &M, const uint64_t &N, int nworkers, size_t k,
+                                 size_t first_diag = 1, std::function<void(size_t)> on_diagonal_done = nullptr) {
+    if(first_diag >= N) return 0; // nothing left to compute
+    std::vector<std::atomic<size_t>> trapezoid_done(nworkers);
+    auto make_farm = [&]() {
+        std::vector<std::unique_ptr<ff::ff_node>> W;
+        for(auto i = 0; i < nworkers; ++i)
+            W.push_back(std::make_unique<FusedWorker>(M, N, nworkers, trapezoid_done));
+        return W;
+    };
+    FusedEmitter emitter(N, nworkers, k, first_diag);
+    FusedCollector collector(nworkers, on_diagonal_done);
+    ff::ff_Farm<> farm(std::move(make_farm()), emitter, collector);
+    farm.wrap_around(); // backward connection from collector to emitter
+    // round robin: worker i gets the i-th copy of the superstep, so every block is computed exactly once
+
+    if(farm.run_and_wait_end() < 0) {
+        ff::error("running farm");
+        return 0;
+    }
+    return emitter.n_steps;
+}
+
 #endif // STENCIL_HPP
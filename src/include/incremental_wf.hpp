@@ -0,0 +1,78 @@
+#ifndef INCREMENTAL_WF_HPP
+#define INCREMENTAL_WF_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "matrix_wf.hpp"
+#include "cone_wf.hpp"
+#include "progress_wf.hpp"
+
+// ------------------------------------------------------------------
+// -------------------- INCREMENTAL RECOMPUTATION -------------------
+// ------------------------------------------------------------------
+// Element (a,b) depends only on the main diagonal entries M[k][k] with a <= k <= b (see cone_wf.hpp), so after
+// changing M[k][k] only the rectangle of rows 0..k and columns k..N-1 has to be recomputed: on diagonal d the rows
+// max(0, k-d)..min(k, N-1-d). IncrementalWavefront keeps a computed matrix and, for a set of edits of the main
+// diagonal, recomputes the union of their rectangles diagonal by diagonal, each diagonal in parallel with OpenMP
+// (if compiled with -fopenmp), with the same kernel as compute_stencil_optim.
+
+struct IncrementalStats {
+    uint64_t edits = 0;    // main diagonal entries actually changed
+    uint64_t elements = 0; // elements recomputed
+    double work = 0;       // multiply-adds
+    double full_work = 0;  // multiply-adds of a run from scratch
+    double saved() const { return full_work > 0 ? 1 - work / full_work : 0; }
+};
+
+class IncrementalWavefront {
+public:
+    // M: a matrix computed by any of the backends (both triangles)
+    IncrementalWavefront(Matrix &M, uint64_t N): M(M), N(N) {}
+
+    // sets M[k][k] = value for each edit (k, value) and brings the rest of the matrix up to date
+    IncrementalStats update(const std::vector<std::pair<uint64_t, double>> &edits) {
+        IncrementalStats stats;
+        stats.full_work = wavefront_work_until(N, N - 1);
+        std::vector<uint64_t> changed;
+        for (auto [k, value] : edits) {
+            if (k >= N || M[k][k] == value) continue;
+            M[k][k] = value;
+            changed.push_back(k);
+        }
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        stats.edits = changed.size();
+        if (changed.empty()) return stats;
+
+        for (uint64_t diag = 1; diag < N; ++diag) {
+            std::vector<ConeRange> rows;
+            for (auto k : changed)
+                rows.push_back({k >= diag ? k - diag : 0, std::min(k, N - 1 - diag)});
+            for (auto [first, last] : merge_ranges(rows)) {
+                uint64_t count = last - first + 1;
+                #pragma omp parallel for schedule(static) if(count * diag >= (1 << 16))
+                for (uint64_t i = first; i <= last; ++i) {
+                    auto i_plus_diag = i + diag;
+                    double temp = 0.0;
+                    for (uint64_t j = 0; j < diag; ++j) // for each elem. in the stencil
+                        temp += M[i][i+j] * M[i_plus_diag][i_plus_diag - j];
+                    temp = std::cbrt(temp); // cube root
+                    M[i_plus_diag][i] = temp;
+                    M[i][i_plus_diag] = temp;
+                }
+                stats.elements += count;
+                stats.work += double(count) * diag;
+            }
+        }
+        return stats;
+    }
+
+private:
+    Matrix &M;
+    uint64_t N;
+};
+
+#endif // INCREMENTAL_WF_HPP
@@ -0,0 +1,91 @@
+#ifndef LANES_WF_HPP
+#define LANES_WF_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "matrix_wf.hpp"
+
+// ------------------------------------------------------------------
+// ---------------------- LANE-INTERLEAVED BATCH --------------------
+// ------------------------------------------------------------------
+// L matrices of the same N (different initial diagonals) stored element by element together: element (i, j)
+// of the L instances is a contiguous group of L doubles. The kernel runs the recurrence of compute_stencil_optim
+// on all of them at once: each step of a dot product is one full-width multiply-add over the L lanes, instead
+// of vectorizing the dot product itself, which for small N is mostly short (diag < 64) and wastes the vectors
+// on its head and tail. L = 4 fills an AVX2 register of doubles, L = 8 an AVX-512 one (or two AVX2 ones).
+
+template <int L>
+class LaneMatrix {
+public:
+    explicit LaneMatrix(uint64_t N): N(N), data(N * N * L, 0.0) {}
+
+    // the L values of element (i, j)
+    double *at(uint64_t i, uint64_t j) { return data.data() + (i * N + j) * L; }
+
+    // the initial diagonal of one of the instances
+    void set_diagonal(int lane, const std::vector<double> &diagonal) {
+        for (uint64_t i = 0; i < N; ++i)
+            at(i, i)[lane] = diagonal[i];
+    }
+
+    double get(int lane, uint64_t i, uint64_t j) { return at(i, j)[lane]; }
+
+    const uint64_t N;
+
+private:
+    Row data;
+};
+
+// cube root without a call to libm, so the loop over the lanes vectorizes: an estimate from the exponent and
+// the leading bits of the mantissa (the high word divided by 3, as in fdlibm), then 3 Halley iterations,
+// each tripling the correct digits (about 5 bits, then 15, 45, full precision)
+inline double lanes_cbrt(double x) {
+    double ax = std::fabs(x);
+    uint64_t bits;
+    std::memcpy(&bits, &ax, sizeof(bits));
+    uint64_t estimate = uint64_t(uint32_t(bits >> 32) / 3 + 715094163u) << 32;
+    double y;
+    std::memcpy(&y, &estimate, sizeof(y));
+    for (int k = 0; k < 3; ++k) {
+        double y3 = y * y * y;
+        y = y * (y3 + 2 * ax) / (2 * y3 + ax);
+    }
+    return std::copysign(ax == 0 ? 0.0 : y, x);
+}
+
+// Column by column (going up each column is also a valid order, see compute_band_sequential): the L instances
+// take L times the memory of one, and this way the row of the column being computed stays in cache
+template <int L>
+void compute_stencil_lanes(LaneMatrix<L> &M) {
+    const uint64_t N = M.N;
+    for (uint64_t i_plus_diag = 1; i_plus_diag < N; ++i_plus_diag) {
+        for (uint64_t diag = 1; diag <= i_plus_diag; ++diag) {
+            auto i = i_plus_diag - diag;
+            const double *row = M.at(i, i);                     // M[i][i+j] at row + j*L
+            const double *col = M.at(i_plus_diag, i_plus_diag); // M[i+diag][i+diag-j] at col - j*L
+            // two sums for the even and odd j, so consecutive multiply-adds do not wait for each other
+            double even[L] = {}, odd[L] = {};
+            uint64_t j = 0;
+            for (; j + 1 < diag; j += 2) {
+                for (int l = 0; l < L; ++l) {
+                    even[l] += row[j * L + l] * col[l - int64_t(j * L)];
+                    odd[l] += row[(j + 1) * L + l] * col[l - int64_t((j + 1) * L)];
+                }
+            }
+            if (j < diag) {
+                for (int l = 0; l < L; ++l)
+                    even[l] += row[j * L + l] * col[l - int64_t(j * L)];
+            }
+            double *lower = M.at(i_plus_diag, i), *upper = M.at(i, i_plus_diag);
+            for (int l = 0; l < L; ++l) {
+                double value = lanes_cbrt(even[l] + odd[l]);
+                lower[l] = value;
+                upper[l] = value;
+            }
+        }
+    }
+}
+
+#endif // LANES_WF_HPP
@@ -0,0 +1,179 @@
+#ifndef MATRIX_WF_HPP
+#define MATRIX_WF_HPP
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+#include <sys/mman.h>
+
+// ------------------------------------------------------------------
+// ------------------------- MATRIX STORAGE -------------------------
+// ------------------------------------------------------------------
+// The matrix of all the drivers is a vector of rows. By default the rows are allocated as usual; with
+// WF_MATRIX_ALLOC they are carved out of large chunks of memory instead:
+//   padded:  4 KiB pages, rows one after the other, separated by WF_ROW_PADDING bytes (default 64)
+//   thp:     as padded, on 2 MiB transparent huge pages (madvise(MADV_HUGEPAGE))
+//   hugetlb: as padded, on explicit huge pages (MAP_HUGETLB, reserved in /proc/sys/vm/nr_hugepages);
+//            falls back to thp if none are available
+// With huge pages, the rows M[row][row+j] and M[col][col-j] read by the inner loop need 1 TLB entry every
+// 2 MiB instead of every 4 KiB. The padding shifts consecutive rows by a cache line, so the rows of a
+// power-of-two N do not all start at the same cache set and the same 4 KiB offset.
+
+enum class MatrixAllocation { standard, padded, thp, hugetlb };
+
+struct MatrixAllocationConfig {
+    MatrixAllocation mode = MatrixAllocation::standard;
+    size_t row_padding = 64;
+};
+
+constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+constexpr size_t MATRIX_CHUNK_SIZE = 64 << 20;
+constexpr size_t ROW_ALIGNMENT = 64;
+
+inline const char *matrix_allocation_name(MatrixAllocation mode) {
+    switch (mode) {
+    case MatrixAllocation::padded: return "padded";
+    case MatrixAllocation::thp: return "thp";
+    case MatrixAllocation::hugetlb: return "hugetlb";
+    default: return "standard";
+    }
+}
+
+inline MatrixAllocationConfig matrix_allocation_from_env() {
+    MatrixAllocationConfig config;
+    if (const char *mode = std::getenv("WF_MATRIX_ALLOC")) {
+        std::string name = mode;
+        if (name == "padded") config.mode = MatrixAllocation::padded;
+        else if (name == "thp") config.mode = MatrixAllocation::thp;
+        else if (name == "hugetlb") config.mode = MatrixAllocation::hugetlb;
+    }
+    if (const char *padding = std::getenv("WF_ROW_PADDING"))
+        config.row_padding = std::strtoull(padding, nullptr, 10);
+    return config;
+}
+
+// the configuration used for the matrices allocated from now on
+inline MatrixAllocationConfig &matrix_allocation() {
+    static MatrixAllocationConfig config = matrix_allocation_from_env();
+    return config;
+}
+
+inline void set_matrix_allocation(MatrixAllocation mode, size_t row_padding = 64) {
+    matrix_allocation() = {mode, row_padding};
+}
+
+// bump allocator over large mmapped chunks. A chunk is unmapped when all the rows allocated in it are freed
+class MatrixArena {
+public:
+    static MatrixArena &instance() {
+        static MatrixArena arena;
+        return arena;
+    }
+
+    void *allocate(size_t bytes, const MatrixAllocationConfig &config) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Chunk *chunk = current[int(config.mode)];
+        size_t offset = chunk ? (chunk->used + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT : 0;
+        if (chunk == nullptr || offset + bytes > chunk->size) {
+            chunk = new_chunk(std::max(MATRIX_CHUNK_SIZE, (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE), config.mode);
+            if (chunk == nullptr) throw std::bad_alloc();
+            current[int(config.mode)] = chunk;
+            offset = 0;
+        }
+        chunk->used = offset + bytes + config.row_padding;
+        chunk->live++;
+        return chunk->base + offset;
+    }
+
+    // returns false if p was not allocated here
+    bool deallocate(void *p) {
+        if (n_chunks.load(std::memory_order_relaxed) == 0) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = chunks.upper_bound(static_cast<char *>(p));
+        if (it == chunks.begin()) return false;
+        --it;
+        Chunk &chunk = it->second;
+        if (static_cast<char *>(p) >= chunk.base + chunk.size) return false;
+        if (--chunk.live == 0) {
+            for (auto &c : current)
+                if (c == &chunk) c = nullptr;
+            munmap(chunk.base, chunk.size);
+            chunks.erase(it);
+            n_chunks--;
+        }
+        return true;
+    }
+
+private:
+    struct Chunk {
+        char *base;
+        size_t size;
+        size_t used = 0;
+        size_t live = 0;
+    };
+
+    Chunk *new_chunk(size_t size, MatrixAllocation mode) {
+        void *base = MAP_FAILED;
+        if (mode == MatrixAllocation::hugetlb) {
+            base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (base == MAP_FAILED && !hugetlb_warned) {
+                std::cerr << "Warning: no explicit huge pages available, using transparent huge pages" << std::endl;
+                hugetlb_warned = true;
+            }
+        }
+        if (base == MAP_FAILED) {
+            // map one huge page more and trim it, so the chunk starts at a huge page boundary
+            void *raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) return nullptr;
+            uintptr_t start = (uintptr_t(raw) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            if (start > uintptr_t(raw)) munmap(raw, start - uintptr_t(raw));
+            munmap(reinterpret_cast<void *>(start + size), uintptr_t(raw) + HUGE_PAGE_SIZE - start);
+            base = reinterpret_cast<void *>(start);
+            madvise(base, size, mode == MatrixAllocation::padded ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+        }
+        auto it = chunks.emplace(static_cast<char *>(base), Chunk{static_cast<char *>(base), size}).first;
+        n_chunks++;
+        return &it->second;
+    }
+
+    std::mutex mutex;
+    std::map<char *, Chunk> chunks; // by base address
+    Chunk *current[4] = {nullptr, nullptr, nullptr, nullptr}; // chunk rows are being allocated from, per mode
+    std::atomic<size_t> n_chunks{0};
+    bool hugetlb_warned = false;
+};
+
+template <typename T>
+struct MatrixAllocator {
+    using value_type = T;
+    MatrixAllocator() = default;
+    template <typename U>
+    MatrixAllocator(const MatrixAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        auto &config = matrix_allocation();
+        if (config.mode == MatrixAllocation::standard)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(MatrixArena::instance().allocate(n * sizeof(T), config));
+    }
+    void deallocate(T *p, size_t) {
+        if (!MatrixArena::instance().deallocate(p))
+            ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const MatrixAllocator<T> &, const MatrixAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const MatrixAllocator<T> &, const MatrixAllocator<U> &) { return false; }
+
+using Row = std::vector<double, MatrixAllocator<double>>;
+using Matrix = std::vector<Row>;
+
+#endif // MATRIX_WF_HPP
@@ -0,0 +1,90 @@
+#ifndef MPI_SHARED_WF_HPP
+#define MPI_SHARED_WF_HPP
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+
+// ------------------------------------------------------------------
+// ------------------ MPI SHARED-MEMORY MATRIX ----------------------
+// ------------------------------------------------------------------
+// The ranks on the same node (MPI_Comm_split_type SHARED) share one N x N matrix, allocated by the first rank of
+// the node with MPI_Win_allocate_shared, instead of keeping a copy each. Rows and columns computed by a neighbour on
+// the same node are read in place after the barrier that ends each diagonal (with MPI_Win_sync before and after it,
+// for the memory model of the window): only the first and the last rank of a node exchange messages, with the
+// ranks of the nodes before and after. This needs the ranks of a node to be consecutive (the default block mapping
+// of mpirun, or --map-by core); otherwise, with one rank per node, or with WF_MPI_SHARED=0 every rank keeps its
+// own matrix and all the neighbours exchange messages.
+
+struct NodeTopology {
+    MPI_Comm node_comm = MPI_COMM_NULL;
+    int node_rank = 0;
+    int node_size = 1;
+    std::vector<int> node_of; // for each rank, the world rank of the first rank of its node
+    bool shared = false;      // the ranks of a node share the matrix
+
+    bool same_node(int a, int b) const { return shared && node_of[a] == node_of[b]; }
+};
+
+inline NodeTopology node_topology(int rank, int size) {
+    NodeTopology topology;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &topology.node_comm);
+    MPI_Comm_rank(topology.node_comm, &topology.node_rank);
+    MPI_Comm_size(topology.node_comm, &topology.node_size);
+    int leader = rank;
+    MPI_Bcast(&leader, 1, MPI_INT, 0, topology.node_comm);
+    topology.node_of.resize(size);
+    MPI_Allgather(&leader, 1, MPI_INT, topology.node_of.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    bool consecutive = true, several = false;
+    for (int r = 1; r < size; r++) {
+        if (topology.node_of[r] == topology.node_of[r - 1])
+            several = true;
+        else if (topology.node_of[r] != r) // a node starts with its leader
+            consecutive = false;
+    }
+    const char *env = std::getenv("WF_MPI_SHARED");
+    bool enabled = env == nullptr || std::string(env) != "0";
+    topology.shared = enabled && consecutive && several;
+    if (rank == 0 && enabled && several && !consecutive)
+        std::cout << "Warning: the ranks of a node are not consecutive, every rank keeps its own matrix" << std::endl;
+    return topology;
+}
+
+// the matrix of a node, in a shared window: M[row][col] as for Matrix
+class SharedMatrix {
+public:
+    SharedMatrix(size_t N, const NodeTopology &topology): N(N) {
+        MPI_Aint bytes = topology.node_rank == 0 ? MPI_Aint(N) * N * sizeof(double) : 0;
+        MPI_Win_allocate_shared(bytes, sizeof(double), MPI_INFO_NULL, topology.node_comm, &data, &window);
+        if (topology.node_rank != 0) {
+            MPI_Aint size;
+            int disp_unit;
+            MPI_Win_shared_query(window, 0, &size, &disp_unit, &data);
+        }
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, window); // passive target epoch, synchronized with MPI_Win_sync
+    }
+    ~SharedMatrix() {
+        MPI_Win_unlock_all(window);
+        MPI_Win_free(&window);
+    }
+    SharedMatrix(const SharedMatrix &) = delete;
+    SharedMatrix &operator=(const SharedMatrix &) = delete;
+
+    double *operator[](size_t row) { return data + row * N; }
+    const double *operator[](size_t row) const { return data + row * N; }
+    size_t size() const { return N; }
+
+    // makes the stores of this rank visible to the node, and the ones of the others to this rank (around a barrier)
+    void sync() { MPI_Win_sync(window); }
+
+private:
+    size_t N;
+    double *data = nullptr;
+    MPI_Win window;
+};
+
+#endif // MPI_SHARED_WF_HPP
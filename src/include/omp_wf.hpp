@@ -0,0 +1,48 @@
+#ifndef OMP_WF_HPP
+#define OMP_WF_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include "matrix_wf.hpp"
+#include "progress_wf.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ------------------------------------------------------------------
+// --------------------- OPENMP IMPLEMENTATION ----------------------
+// ------------------------------------------------------------------
+// compile with -fopenmp, otherwise the pragma is ignored and this is the sequential wavefront
+
+// on_diagonal_done and progress are called by the master thread after each diagonal
+void inline compute_stencil_omp(Matrix &M, const uint64_t &N, ProgressMonitor *progress = nullptr,
+                                std::function<void(size_t)> on_diagonal_done = nullptr) {
+    for(uint64_t diag = 1; diag < N; ++diag) { // for each upper diagonal
+        #pragma omp parallel
+        {
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+            ProgressTimer timer(progress, thread);
+            #pragma omp for nowait
+            for(uint64_t i = 0; i < (N-diag); ++i) { // for each elem. in the diagonal
+                auto i_plus_diag = i + diag;
+                double temp = 0.0;
+                // #pragma omp parallel for reduction(+:temp)
+                for (uint64_t j = 0; j < diag; ++j) { // for each elem. in the stencil
+                    temp += M[i][i+j] * M[i_plus_diag][i_plus_diag - j];
+                }
+                M[i_plus_diag][i] = temp;
+                M[i_plus_diag][i] = std::cbrt(M[i_plus_diag][i]); // cube root
+                M[i][i_plus_diag] = M[i_plus_diag][i]; // store the result also in the upper triangle
+            }
+        } // implicit barrier: the diagonal is complete
+        if (on_diagonal_done) on_diagonal_done(diag);
+        if (progress) progress->diagonal_done(diag);
+    }
+}
+
+#endif // OMP_WF_HPP
@@ -0,0 +1,276 @@
+#ifndef PROGRESS_WF_HPP
+#define PROGRESS_WF_HPP
+
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <new>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ------------------------------------------------------------------
+// ------------------------ LIVE PROGRESS ---------------------------
+// ------------------------------------------------------------------
+// With WF_PROGRESS=<file> the drivers keep their progress in a small file mapped in memory (put it in /dev/shm
+// to have a plain shared-memory segment), read by the `progress` tool while the computation runs.
+// The thread that already sees every diagonal complete (the collector of the farms, the master thread between
+// the OpenMP parallel loops, rank 0 of MPI) calls diagonal_done(): it only reads the clock, and every
+// WF_PROGRESS_INTERVAL seconds (default 1) publishes a snapshot under a sequence lock. The workers add their busy
+// time to their own cache line with relaxed stores, once per task: nothing on the hot path waits on the monitor.
+// Diagonal d has N-d elements, each a dot product of length d, so the work done after diagonal d is
+//   sum_{k=1}^{d} k(N-k) multiply-adds, and the ETA is the remaining work over the recent throughput.
+
+constexpr char PROGRESS_MAGIC[8] = {'W', 'F', 'P', 'R', 'O', 'G', '0', '1'};
+constexpr int PROGRESS_MAX_WORKERS = 256;
+
+struct alignas(64) ProgressWorkerSlot {
+    std::atomic<uint64_t> busy_ns{0};
+};
+
+struct ProgressState {
+    char magic[8];
+    uint64_t N;
+    uint32_t nworkers;
+    int32_t pid;
+    uint64_t start_ns;                  // CLOCK_MONOTONIC, comparable across processes of the same machine
+    std::atomic<uint32_t> sequence{0};  // odd while the snapshot below is being written
+    uint32_t finished;
+    uint64_t diag;                      // last diagonal completed
+    uint64_t elements_done;
+    double work_done;                   // multiply-adds, including the diagonals restored from a checkpoint
+    double total_work;
+    uint64_t update_ns;
+    double instant_gflops;
+    double average_gflops;
+    double eta_seconds;
+    ProgressWorkerSlot workers[PROGRESS_MAX_WORKERS];
+};
+
+struct ProgressSnapshot {
+    uint64_t N = 0;
+    uint32_t nworkers = 0;
+    int32_t pid = 0;
+    uint64_t start_ns = 0;
+    bool finished = false;
+    uint64_t diag = 0;
+    uint64_t elements_done = 0;
+    double work_done = 0;
+    double total_work = 0;
+    uint64_t update_ns = 0;
+    double instant_gflops = 0;
+    double average_gflops = 0;
+    double eta_seconds = 0;
+};
+
+struct ProgressConfig {
+    std::string filename; // empty if progress is not published
+    double interval = 1;  // seconds between two snapshots
+};
+
+inline ProgressConfig progress_config_from_env() {
+    ProgressConfig config;
+    if (const char *file = std::getenv("WF_PROGRESS"))
+        config.filename = file;
+    if (const char *interval = std::getenv("WF_PROGRESS_INTERVAL"))
+        config.interval = std::atof(interval);
+    return config;
+}
+
+inline uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// multiply-adds of the diagonals 1..diag
+inline double wavefront_work_until(uint64_t N, uint64_t diag) {
+    double d = diag, n = N;
+    return n * d * (d + 1) / 2 - d * (d + 1) * (2 * d + 1) / 6;
+}
+
+// elements of the diagonals 1..diag
+inline uint64_t wavefront_elements_until(uint64_t N, uint64_t diag) {
+    return diag * N - diag * (diag + 1) / 2;
+}
+
+class ProgressMonitor {
+public:
+    // first_diag > 1 when the run restarts from a checkpoint
+    ProgressMonitor(const ProgressConfig &config, uint64_t N, int nworkers, uint64_t first_diag = 1):
+        config(config), N(N) {
+        int fd = open(config.filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, sizeof(ProgressState)) != 0) {
+            std::perror(("progress " + config.filename).c_str());
+            if (fd >= 0) close(fd);
+            return;
+        }
+        void *map = mmap(nullptr, sizeof(ProgressState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            std::perror(("progress " + config.filename).c_str());
+            return;
+        }
+        state = new (map) ProgressState();
+        std::memcpy(state->magic, PROGRESS_MAGIC, 8);
+        state->N = N;
+        state->nworkers = std::min(nworkers, PROGRESS_MAX_WORKERS);
+        state->pid = getpid();
+        state->start_ns = monotonic_ns();
+        state->total_work = wavefront_work_until(N, N - 1);
+        start_work = wavefront_work_until(N, first_diag - 1);
+        last_work = start_work;
+        last_diag = first_diag - 1;
+        last_ns = state->start_ns;
+        publish(first_diag - 1, last_ns);
+    }
+
+    ~ProgressMonitor() {
+        if (state == nullptr) return;
+        finish();
+        munmap(state, sizeof(ProgressState));
+    }
+    ProgressMonitor(const ProgressMonitor &) = delete;
+    ProgressMonitor &operator=(const ProgressMonitor &) = delete;
+
+    // called by a single thread, in order, when diagonal diag is complete
+    void diagonal_done(uint64_t diag) {
+        if (state == nullptr) return;
+        last_diag = diag;
+        uint64_t now = monotonic_ns();
+        if (now - last_ns >= config.interval * 1e9 || diag == N - 1)
+            publish(diag, now);
+    }
+
+    // busy time of a worker, called by the worker itself
+    void add_busy(int worker, uint64_t ns) {
+        if (state == nullptr || worker >= PROGRESS_MAX_WORKERS) return;
+        auto &slot = state->workers[worker].busy_ns;
+        slot.store(slot.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    }
+
+    void finish() {
+        if (state == nullptr || state->finished) return;
+        publish(last_diag, monotonic_ns(), true);
+    }
+
+private:
+    void publish(uint64_t diag, uint64_t now, bool finished = false) {
+        double work = wavefront_work_until(N, diag);
+        double elapsed = (now - state->start_ns) * 1e-9;
+        double interval = (now - last_ns) * 1e-9;
+        // a snapshot without new diagonals (the final one) keeps the last throughput
+        double instant = work > last_work && interval > 0 ? 2 * (work - last_work) / interval * 1e-9 : state->instant_gflops;
+        double average = elapsed > 0 ? 2 * (work - start_work) / elapsed * 1e-9 : 0;
+        // recent throughput, or the average when the last interval completed no diagonal
+        double rate = instant > 0 ? instant : average;
+
+        state->sequence.fetch_add(1, std::memory_order_acq_rel);
+        state->diag = diag;
+        state->elements_done = wavefront_elements_until(N, diag);
+        state->work_done = work;
+        state->update_ns = now;
+        state->instant_gflops = instant;
+        state->average_gflops = average;
+        state->eta_seconds = rate > 0 ? 2 * (state->total_work - work) / rate * 1e-9 : -1;
+        state->finished = finished;
+        state->sequence.fetch_add(1, std::memory_order_release);
+
+        last_ns = now;
+        last_work = work;
+    }
+
+    ProgressConfig config;
+    uint64_t N;
+    ProgressState *state = nullptr;
+    uint64_t last_diag = 0;
+    uint64_t last_ns = 0;
+    double last_work = 0;
+    double start_work = 0;
+};
+
+// times a piece of work of a worker, for ProgressMonitor::add_busy
+struct ProgressTimer {
+    ProgressTimer(ProgressMonitor *progress, int worker): progress(progress), worker(worker), start(progress ? monotonic_ns() : 0) {}
+    ~ProgressTimer() { stop(); }
+    void stop() {
+        if (progress) progress->add_busy(worker, monotonic_ns() - start);
+        progress = nullptr;
+    }
+    ProgressMonitor *progress;
+    int worker;
+    uint64_t start;
+};
+
+// read-only view of the progress file, used by the `progress` tool
+class ProgressReader {
+public:
+    explicit ProgressReader(const std::string &filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        // the pages past the end of a shorter file (truncated, or not a progress file) raise SIGBUS when read
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(ProgressState)) {
+            close(fd);
+            return;
+        }
+        void *map = mmap(nullptr, sizeof(ProgressState), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) return;
+        state = static_cast<const ProgressState *>(map);
+        if (std::memcmp(state->magic, PROGRESS_MAGIC, 8) != 0) {
+            munmap(const_cast<ProgressState *>(state), sizeof(ProgressState));
+            state = nullptr;
+        }
+    }
+    ~ProgressReader() {
+        if (state != nullptr) munmap(const_cast<ProgressState *>(state), sizeof(ProgressState));
+    }
+    ProgressReader(const ProgressReader &) = delete;
+    ProgressReader &operator=(const ProgressReader &) = delete;
+
+    bool valid() const { return state != nullptr; }
+
+    // a consistent copy of the last snapshot
+    ProgressSnapshot snapshot() const {
+        ProgressSnapshot s;
+        uint32_t before, after;
+        do {
+            before = state->sequence.load(std::memory_order_acquire);
+            s.N = state->N;
+            s.nworkers = state->nworkers;
+            s.pid = state->pid;
+            s.start_ns = state->start_ns;
+            s.finished = state->finished;
+            s.diag = state->diag;
+            s.elements_done = state->elements_done;
+            s.work_done = state->work_done;
+            s.total_work = state->total_work;
+            s.update_ns = state->update_ns;
+            s.instant_gflops = state->instant_gflops;
+            s.average_gflops = state->average_gflops;
+            s.eta_seconds = state->eta_seconds;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = state->sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1));
+        return s;
+    }
+
+    // fraction of the time since the start (until the end, if the run is over) a worker spent computing
+    double busy_fraction(int worker, const ProgressSnapshot &s) const {
+        double elapsed = double((s.finished ? s.update_ns : monotonic_ns()) - s.start_ns);
+        return elapsed > 0 ? state->workers[worker].busy_ns.load(std::memory_order_relaxed) / elapsed : 0;
+    }
+
+private:
+    const ProgressState *state = nullptr;
+};
+
+#endif // PROGRESS_WF_HPP
@@ -0,0 +1,172 @@
+#ifndef REFERENCE_WF_HPP
+#define REFERENCE_WF_HPP
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <filesystem>
+#include <unistd.h>
+#include "sequential_wf.hpp"
+
+// ------------------------------------------------------------------
+// --------------------- GOLDEN REFERENCE CACHE ---------------------
+// ------------------------------------------------------------------
+// Instead of rerunning compute_stencil_optim (O(N^3) time, a second N*N matrix) to check a parallel result,
+// the sequential result is summarized once per N in a fingerprint per diagonal, saved to
+// <reference dir>/reference_<N>.bin. A run is then checked in O(N^2) comparing its fingerprints with the cached ones.
+// The fingerprint is made of sums (with and without pseudo-random weights per element), so different summation
+// orders still match within the tolerance, the pieces computed by different MPI ranks can simply be added,
+// and a wrong or swapped element shows up in the diagonal it belongs to.
+// The reference is for the initial diagonal used by all the drivers, M[i][i] = (i+1)/N.
+
+struct DiagonalFingerprint {
+    uint64_t count = 0;
+    double sum = 0;
+    double weighted_sum = 0;
+    double abs_sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+};
+
+constexpr char REFERENCE_MAGIC[8] = {'W', 'F', 'R', 'E', 'F', '0', '0', '1'};
+
+// weight in [0.5, 1.5), a hash of the position of the element
+inline double fingerprint_weight(uint64_t row, uint64_t diag) {
+    uint64_t z = row * 0x9E3779B97F4A7C15ULL + diag * 0xD1B54A32D192ED03ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return 0.5 + double((z ^ (z >> 31)) >> 11) / double(1ULL << 53);
+}
+
+inline void add_to_fingerprint(DiagonalFingerprint &fingerprint, uint64_t row, uint64_t diag, double value) {
+    fingerprint.count++;
+    fingerprint.sum += value;
+    fingerprint.weighted_sum += value * fingerprint_weight(row, diag);
+    fingerprint.abs_sum += std::abs(value);
+    fingerprint.min = std::min(fingerprint.min, value);
+    fingerprint.max = std::max(fingerprint.max, value);
+}
+
+// fingerprints of all the diagonals of the upper triangle, O(N^2)
+inline std::vector<DiagonalFingerprint> compute_fingerprints(const Matrix &M, uint64_t N) {
+    std::vector<DiagonalFingerprint> fingerprints(N);
+    for (uint64_t row = 0; row < N; ++row)
+        for (uint64_t col = row; col < N; ++col)
+            add_to_fingerprint(fingerprints[col - row], row, col - row, M[row][col]);
+    return fingerprints;
+}
+
+inline std::string reference_filename(uint64_t N) {
+    std::string dir = "../results/reference";
+    if (const char *env_dir = std::getenv("WF_REFERENCE_DIR"))
+        dir = env_dir;
+    return dir + "/reference_" + std::to_string(N) + ".bin";
+}
+
+inline bool load_reference(uint64_t N, std::vector<DiagonalFingerprint> &fingerprints) {
+    FILE *f = std::fopen(reference_filename(N).c_str(), "rb");
+    if (f == nullptr) return false;
+    char magic[8];
+    uint64_t file_N = 0;
+    bool ok = std::fread(magic, 8, 1, f) == 1 && std::memcmp(magic, REFERENCE_MAGIC, 8) == 0 &&
+              std::fread(&file_N, sizeof(file_N), 1, f) == 1 && file_N == N;
+    if (ok) {
+        fingerprints.resize(N);
+        ok = std::fread(fingerprints.data(), sizeof(DiagonalFingerprint), N, f) == N;
+    }
+    std::fclose(f);
+    return ok;
+}
+
+inline bool save_reference(uint64_t N, const std::vector<DiagonalFingerprint> &fingerprints) {
+    auto filename = reference_filename(N);
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+    // write to a temporary file and rename it, so concurrent runs never read half a reference
+    auto tmp_filename = filename + ".tmp" + std::to_string(getpid());
+    FILE *f = std::fopen(tmp_filename.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(REFERENCE_MAGIC, 8, 1, f) == 1 && std::fwrite(&N, sizeof(N), 1, f) == 1 &&
+              std::fwrite(fingerprints.data(), sizeof(DiagonalFingerprint), N, f) == N;
+    ok = std::fclose(f) == 0 && ok;
+    ok = ok && std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+    if (!ok) std::remove(tmp_filename.c_str());
+    return ok;
+}
+
+inline void init_reference_matrix(Matrix &M, uint64_t N) {
+    for (uint64_t i = 0; i < N; ++i)
+        M[i][i] = double(i + 1) / double(N);
+}
+
+// the cached reference for N. On a miss it is computed (once) with compute_stencil_optim, or taken from
+// sequential_result if the caller already has the sequential matrix
+inline std::vector<DiagonalFingerprint> get_reference(uint64_t N, const Matrix *sequential_result = nullptr) {
+    std::vector<DiagonalFingerprint> fingerprints;
+    if (load_reference(N, fingerprints)) return fingerprints;
+    if (sequential_result != nullptr) {
+        fingerprints = compute_fingerprints(*sequential_result, N);
+    } else {
+        std::cout << "no reference for N = " << N << " in " << reference_filename(N) << ", computing it" << std::endl;
+        Matrix M(N, Row(N, 0.0));
+        init_reference_matrix(M, N);
+        compute_stencil_optim(M, N);
+        fingerprints = compute_fingerprints(M, N);
+    }
+    if (!save_reference(N, fingerprints))
+        std::cout << "Warning: unable to save the reference to " << reference_filename(N) << std::endl;
+    return fingerprints;
+}
+
+// diagonals whose fingerprint differs from the reference. tolerance is per element, like the element-wise checks
+inline std::vector<uint64_t> compare_fingerprints(const std::vector<DiagonalFingerprint> &result,
+                                                  const std::vector<DiagonalFingerprint> &reference, double tolerance = 1e-6) {
+    std::vector<uint64_t> wrong_diagonals;
+    for (uint64_t diag = 0; diag < reference.size(); ++diag) {
+        auto &a = result[diag];
+        auto &b = reference[diag];
+        double tol = tolerance * b.count;
+        if (a.count != b.count || !(std::abs(a.sum - b.sum) <= tol) || !(std::abs(a.weighted_sum - b.weighted_sum) <= tol) ||
+            !(std::abs(a.abs_sum - b.abs_sum) <= tol) || !(std::abs(a.min - b.min) <= tolerance) ||
+            !(std::abs(a.max - b.max) <= tolerance))
+            wrong_diagonals.push_back(diag);
+    }
+    return wrong_diagonals;
+}
+
+// prints the outcome of the comparison; returns true if the result matches the reference
+inline bool report_validation(const std::vector<uint64_t> &wrong_diagonals, const std::string &name = "result") {
+    if (wrong_diagonals.empty()) {
+        std::cout << "Validation passed: " << name << " matches the reference" << std::endl;
+        return true;
+    }
+    std::cout << "Validation FAILED: " << name << " differs from the reference in " << wrong_diagonals.size()
+              << " diagonals, the first is diagonal " << wrong_diagonals.front() << std::endl;
+    return false;
+}
+
+// validates M against the cached reference in O(N^2) (plus the sequential run on a cache miss)
+inline bool validate(const Matrix &M, uint64_t N, const std::string &name = "result") {
+    auto start = std::chrono::steady_clock::now();
+    auto reference = get_reference(N);
+    auto wrong_diagonals = compare_fingerprints(compute_fingerprints(M, N), reference);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "validation time: " << elapsed.count() << "s" << std::endl;
+    return report_validation(wrong_diagonals, name);
+}
+
+// the drivers validate their result if WF_VALIDATE is set
+inline bool validation_enabled() {
+    const char *env = std::getenv("WF_VALIDATE");
+    return env != nullptr && std::string(env) != "0";
+}
+
+#endif // REFERENCE_WF_HPP
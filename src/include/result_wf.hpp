@@ -0,0 +1,242 @@
+#ifndef RESULT_WF_HPP
+#define RESULT_WF_HPP
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "matrix_wf.hpp"
+
+// ------------------------------------------------------------------
+// ---------------------- BINARY RESULT FORMAT ----------------------
+// ------------------------------------------------------------------
+// The result file stores only the upper triangle (main diagonal included), packed by rows:
+// row i holds M[i][i..N-1], so element (i, j) is at i*N - i*(i-1)/2 + (j-i).
+// The header takes the first 4 KiB (so the data is aligned for O_DIRECT):
+//   magic, N, precision (bytes per element: 8 = double, 4 = float), checksum, data offset, data bytes.
+// The checksum is a sum of hashes of (index, bits) pairs: it does not depend on the order the elements
+// are written in, so pieces of the triangle can be checksummed independently (MPI ranks, threads) and added.
+
+constexpr char RESULT_MAGIC[8] = {'W', 'F', 'R', 'E', 'S', '0', '0', '1'};
+constexpr uint64_t RESULT_DATA_OFFSET = 4096;
+constexpr size_t RESULT_BUFFER_SIZE = 4 << 20; // large sequential writes
+
+struct ResultHeader {
+    char magic[8];
+    uint64_t N;
+    uint32_t precision;
+    uint32_t reserved;
+    uint64_t checksum;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+};
+
+struct ResultConfig {
+    std::string filename;  // empty if the result is not saved
+    uint32_t precision = 8;
+};
+
+// the result is saved with WF_RESULT=<file> (WF_RESULT_PRECISION=single to store floats)
+inline ResultConfig result_config_from_env() {
+    ResultConfig config;
+    if (const char *file = std::getenv("WF_RESULT"))
+        config.filename = file;
+    if (const char *precision = std::getenv("WF_RESULT_PRECISION"))
+        config.precision = std::string(precision) == "single" ? 4 : 8;
+    return config;
+}
+
+inline uint64_t result_packed_index(uint64_t N, uint64_t i, uint64_t j) {
+    return i * N - i * (i - 1) / 2 + (j - i);
+}
+
+inline uint64_t result_elements(uint64_t N) {
+    return N * (N + 1) / 2;
+}
+
+inline uint64_t result_checksum_term(uint64_t index, uint64_t bits) {
+    // splitmix64 finalizer of the element bits mixed with their position
+    uint64_t z = bits ^ (index * 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// converts count elements of a row to the file precision into out, returns their checksum
+inline uint64_t result_pack(const double *values, uint64_t count, uint64_t first_index, uint32_t precision, char *out) {
+    uint64_t checksum = 0;
+    for (uint64_t k = 0; k < count; ++k) {
+        uint64_t bits = 0;
+        if (precision == 4) {
+            float value = values[k];
+            std::memcpy(out + k * 4, &value, 4);
+            std::memcpy(&bits, &value, 4);
+        } else {
+            std::memcpy(out + k * 8, &values[k], 8);
+            std::memcpy(&bits, &values[k], 8);
+        }
+        checksum += result_checksum_term(first_index + k, bits);
+    }
+    return checksum;
+}
+
+inline ResultHeader make_result_header(uint64_t N, uint32_t precision, uint64_t checksum) {
+    ResultHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RESULT_MAGIC, 8);
+    header.N = N;
+    header.precision = precision;
+    header.checksum = checksum;
+    header.data_offset = RESULT_DATA_OFFSET;
+    header.data_bytes = result_elements(N) * precision;
+    return header;
+}
+
+// writes the upper triangle of M to filename, with O_DIRECT when the filesystem supports it
+// (the data does not pollute the page cache) and 4 MiB writes otherwise. Returns false on errors.
+inline bool write_result(const ResultConfig &config, const Matrix &M, uint64_t N) {
+    auto start = std::chrono::steady_clock::now();
+    bool direct = true;
+    int fd = open(config.filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (fd < 0 && errno == EINVAL) { // e.g. tmpfs
+        direct = false;
+        fd = open(config.filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0) {
+        std::perror(("result " + config.filename).c_str());
+        return false;
+    }
+    char *buffer = static_cast<char *>(std::aligned_alloc(RESULT_DATA_OFFSET, RESULT_BUFFER_SIZE));
+    size_t filled = 0;
+    off_t offset = RESULT_DATA_OFFSET;
+    uint64_t checksum = 0;
+    bool ok = true;
+    auto flush = [&](size_t bytes) { // bytes is a multiple of the block size, except for the last write without O_DIRECT
+        ok = ok && pwrite(fd, buffer, bytes, offset) == ssize_t(bytes);
+        offset += bytes;
+        filled = 0;
+    };
+
+    for (uint64_t i = 0; i < N && ok; ++i) {
+        uint64_t j = i;
+        while (j < N) {
+            uint64_t count = std::min<uint64_t>(N - j, (RESULT_BUFFER_SIZE - filled) / config.precision);
+            checksum += result_pack(&M[i][j], count, result_packed_index(N, i, j), config.precision, buffer + filled);
+            filled += count * config.precision;
+            j += count;
+            if (RESULT_BUFFER_SIZE - filled < config.precision) flush(filled);
+        }
+    }
+    uint64_t data_end = offset + filled;
+    if (filled > 0) {
+        size_t bytes = direct ? (filled + RESULT_DATA_OFFSET - 1) / RESULT_DATA_OFFSET * RESULT_DATA_OFFSET : filled;
+        std::memset(buffer + filled, 0, bytes - filled);
+        flush(bytes);
+    }
+    // header last, so a file with a valid header always has all of its data
+    ResultHeader header = make_result_header(N, config.precision, checksum);
+    std::memset(buffer, 0, RESULT_DATA_OFFSET);
+    std::memcpy(buffer, &header, sizeof(header));
+    ok = ok && pwrite(fd, buffer, RESULT_DATA_OFFSET, 0) == ssize_t(RESULT_DATA_OFFSET);
+    ok = ok && ftruncate(fd, data_end) == 0; // drop the O_DIRECT padding
+    close(fd);
+    std::free(buffer);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!ok) {
+        std::perror(("result " + config.filename).c_str());
+        return false;
+    }
+    std::cout << "result written to " << config.filename << ": " << data_end / (1024.0 * 1024.0) << " MiB in "
+              << elapsed.count() << "s (" << data_end / (1024.0 * 1024.0) / elapsed.count() << " MiB/s"
+              << (direct ? ", O_DIRECT" : "") << ")\n";
+    return true;
+}
+
+// read-only view of a result file: the file is mmapped and the elements are read in place, in O(1)
+class ResultView {
+public:
+    explicit ResultView(const std::string &filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(ResultHeader)) {
+            void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                base = static_cast<const char *>(map);
+                length = st.st_size;
+            }
+        }
+        close(fd);
+        if (base == nullptr) return;
+        std::memcpy(&header, base, sizeof(header));
+        // the payload must hold exactly the N (N+1) / 2 elements the header announces, and fit in the file (N is
+        // bounded first so that neither the count nor the sum overflows)
+        if (std::memcmp(header.magic, RESULT_MAGIC, 8) != 0 || (header.precision != 4 && header.precision != 8) ||
+            header.N == 0 || header.N > (uint64_t(1) << 30) ||
+            header.data_bytes != result_elements(header.N) * header.precision || header.data_bytes > length ||
+            header.data_offset > length - header.data_bytes) {
+            munmap(const_cast<char *>(base), length);
+            base = nullptr;
+            return;
+        }
+        data = base + header.data_offset;
+        madvise(const_cast<char *>(base), length, MADV_RANDOM); // single elements: do not read ahead
+    }
+
+    ~ResultView() {
+        if (base != nullptr) munmap(const_cast<char *>(base), length);
+    }
+    ResultView(const ResultView &) = delete;
+    ResultView &operator=(const ResultView &) = delete;
+
+    bool valid() const { return base != nullptr; }
+    uint64_t size() const { return header.N; }
+    uint32_t precision() const { return header.precision; }
+
+    // M[i][j], the matrix is symmetric
+    double operator()(uint64_t i, uint64_t j) const {
+        if (i > j) std::swap(i, j);
+        uint64_t index = result_packed_index(header.N, i, j);
+        if (header.precision == 4) {
+            float value;
+            std::memcpy(&value, data + index * 4, 4);
+            return value;
+        }
+        double value;
+        std::memcpy(&value, data + index * 8, 8);
+        return value;
+    }
+
+    // recomputes the checksum, reading the whole file
+    bool verify() const {
+        madvise(const_cast<char *>(base), length, MADV_SEQUENTIAL);
+        uint64_t checksum = 0;
+        for (uint64_t index = 0; index < result_elements(header.N); ++index) {
+            uint64_t bits = 0;
+            std::memcpy(&bits, data + index * header.precision, header.precision);
+            checksum += result_checksum_term(index, bits);
+        }
+        madvise(const_cast<char *>(base), length, MADV_RANDOM);
+        return checksum == header.checksum;
+    }
+
+private:
+    const char *base = nullptr;
+    const char *data = nullptr;
+    size_t length = 0;
+    ResultHeader header;
+};
+
+#endif // RESULT_WF_HPP
@@ -0,0 +1,207 @@
+#ifndef ROOFLINE_WF_HPP
+#define ROOFLINE_WF_HPP
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+// ------------------------------------------------------------------
+// ------------------------- ROOFLINE MODEL -------------------------
+// ------------------------------------------------------------------
+// With WF_ROOFLINE=1 the drivers measure the peak floating point throughput (independent multiply-add chains on
+// every thread) and the memory bandwidth (STREAM triad on every thread) at startup, and at the end compare the
+// run with the roofline of the machine, diagonal by diagonal:
+//   flops(d) = (N-d) * (2d + 1)              2d for the dot product, 1 for the cube root
+//   bytes(d) = (N-d) * (2d + 2) * 8          the two operand rows and the two stores, if the operands of diagonal d
+//                                            do not fit in the last level cache; else only the 2 stores,
+//                                            since diagonal d+1 reuses all the operands of diagonal d
+//   model(d) = max(flops(d) / peak, bytes(d) / bandwidth)
+// The measured time beyond the model is overhead: synchronization, load imbalance, latency, or a kernel that does
+// not reach the peak of the probe (the dot product is a single dependent chain).
+// WF_ROOFLINE_FILE=<file> also saves the per-diagonal table.
+
+struct RooflineMachine {
+    double peak_gflops = 0;
+    double bandwidth_gbs = 0;
+    size_t llc_bytes = 0;
+    int threads = 1;
+};
+
+inline bool roofline_enabled() {
+    const char *env = std::getenv("WF_ROOFLINE");
+    return env != nullptr && std::string(env) != "0";
+}
+
+// size of the largest cache of cpu0, from sysfs (8 MiB if unknown)
+inline size_t last_level_cache_bytes() {
+    size_t largest = 0;
+    for (int index = 0; index < 8; ++index) {
+        std::ifstream file("/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/size");
+        std::string size;
+        if (!(file >> size)) continue;
+        size_t bytes = std::stoull(size);
+        if (size.back() == 'K') bytes <<= 10;
+        if (size.back() == 'M') bytes <<= 20;
+        largest = std::max(largest, bytes);
+    }
+    return largest > 0 ? largest : 8 << 20;
+}
+
+// runs body(thread) on `threads` threads at once, returns the elapsed seconds
+template <typename F>
+double run_on_threads(int threads, F body) {
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t)
+        pool.emplace_back(body, t);
+    for (auto &thread : pool)
+        thread.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// GFLOP/s of independent multiply-add chains, as many as the compiler can keep in flight (and vectorize)
+inline double probe_peak_gflops(int threads) {
+    constexpr int CHAINS = 32;
+    constexpr uint64_t ITERATIONS = 1 << 20;
+    std::vector<double> sink(threads);
+    double best = 0;
+    for (int r = 0; r < 3; ++r) {
+        double seconds = run_on_threads(threads, [&](int t) {
+            double acc[CHAINS];
+            for (int c = 0; c < CHAINS; ++c) acc[c] = 1.0 + c * 1e-3 + t;
+            double a = 0.999999, b = 1e-7;
+            for (uint64_t i = 0; i < ITERATIONS; ++i)
+                for (int c = 0; c < CHAINS; ++c)
+                    acc[c] = acc[c] * a + b;
+            double sum = 0;
+            for (int c = 0; c < CHAINS; ++c) sum += acc[c];
+            sink[t] = sum; // keeps the loop alive
+        });
+        best = std::max(best, 2.0 * CHAINS * ITERATIONS * threads / seconds * 1e-9);
+    }
+    return best;
+}
+
+// GB/s of the STREAM triad a[i] = b[i] + s*c[i] (24 bytes per element), on arrays 4 times the last level cache
+// (between 32 and 256 MiB each)
+inline double probe_bandwidth_gbs(int threads, size_t llc_bytes) {
+    size_t n = std::clamp<size_t>(llc_bytes * 4, 32 << 20, 256 << 20) / sizeof(double) / threads;
+    std::vector<std::vector<double>> a(threads), b(threads), c(threads);
+    run_on_threads(threads, [&](int t) { // first touch by the thread that uses the arrays
+        a[t].assign(n, 0.0);
+        b[t].assign(n, 1.0);
+        c[t].assign(n, 2.0);
+    });
+    double best = 0;
+    for (int r = 0; r < 3; ++r) {
+        double seconds = run_on_threads(threads, [&](int t) {
+            double *x = a[t].data();
+            const double *y = b[t].data(), *z = c[t].data();
+            for (size_t i = 0; i < n; ++i)
+                x[i] = y[i] + 3.0 * z[i];
+        });
+        best = std::max(best, 24.0 * n * threads / seconds * 1e-9);
+    }
+    return best;
+}
+
+inline RooflineMachine probe_machine(int threads) {
+    RooflineMachine machine;
+    machine.threads = std::max(1, threads);
+    machine.llc_bytes = last_level_cache_bytes();
+    auto start = std::chrono::steady_clock::now();
+    machine.peak_gflops = probe_peak_gflops(machine.threads);
+    machine.bandwidth_gbs = probe_bandwidth_gbs(machine.threads, machine.llc_bytes);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "roofline probes (" << machine.threads << " threads, " << elapsed.count() << "s): peak " << machine.peak_gflops
+              << " GFLOP/s, bandwidth " << machine.bandwidth_gbs << " GB/s, last level cache " << (machine.llc_bytes >> 20) << " MiB"
+              << std::endl;
+    return machine;
+}
+
+inline double diagonal_flops(uint64_t N, uint64_t diag) {
+    return double(N - diag) * (2.0 * diag + 1);
+}
+
+inline double diagonal_bytes(uint64_t N, uint64_t diag, size_t llc_bytes) {
+    double operands = double(N - diag) * 2.0 * diag * sizeof(double);
+    double stores = double(N - diag) * 2.0 * sizeof(double);
+    return operands > llc_bytes ? operands + stores : stores;
+}
+
+// collects the completion time of every diagonal (called in order by a single thread) and prints the report
+class RooflineReport {
+public:
+    RooflineReport(const RooflineMachine &machine, uint64_t N, uint64_t first_diag = 1):
+        machine(machine), N(N), first_diag(first_diag), done(N, 0) {}
+
+    void start() { start_time = std::chrono::steady_clock::now(); }
+
+    void diagonal_done(uint64_t diag) {
+        done[diag] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    // total_seconds: the elapsed time of the whole computation (it may include steps not seen by diagonal_done)
+    void print(double total_seconds, const std::string &name) const {
+        double flops = 0, bytes = 0, compute_time = 0, memory_time = 0, measured = 0;
+        uint64_t memory_bound = 0;
+        std::ofstream file;
+        if (const char *filename = std::getenv("WF_ROOFLINE_FILE")) {
+            file.open(filename);
+            file << "diag flops bytes intensity model_seconds measured_seconds bound\n";
+        }
+        double previous = 0;
+        for (uint64_t diag = first_diag; diag < N; ++diag) {
+            double f = diagonal_flops(N, diag), b = diagonal_bytes(N, diag, machine.llc_bytes);
+            double t_compute = f / (machine.peak_gflops * 1e9), t_memory = b / (machine.bandwidth_gbs * 1e9);
+            bool is_memory_bound = t_memory > t_compute;
+            flops += f;
+            bytes += b;
+            (is_memory_bound ? memory_time : compute_time) += std::max(t_compute, t_memory);
+            memory_bound += is_memory_bound;
+            double t = done[diag] > 0 ? done[diag] - previous : 0;
+            if (done[diag] > 0) previous = done[diag];
+            measured += t;
+            if (file.is_open())
+                file << diag << " " << f << " " << b << " " << f / b << " " << std::max(t_compute, t_memory) << " " << t << " "
+                     << (is_memory_bound ? "memory" : "compute") << "\n";
+        }
+        double model = compute_time + memory_time;
+        double overhead = std::max(0.0, total_seconds - model);
+        double ridge = machine.peak_gflops / machine.bandwidth_gbs;
+        std::string bound = overhead > std::max(compute_time, memory_time) ? "overhead (synchronization, load imbalance or a kernel slower than the peak probe)"
+                          : memory_time > compute_time ? "memory bandwidth" : "compute";
+
+        // formatted apart, so that the precision of std::cout stays the one of the caller
+        std::ostringstream report;
+        report << std::setprecision(4);
+        report << "roofline (" << name << "): " << flops * 1e-9 << " GFLOP, " << bytes * 1e-9 << " GB of minimum memory traffic, "
+               << "intensity " << flops / bytes << " flop/byte (ridge point " << ridge << ")\n";
+        report << "  attainable " << flops / model * 1e-9 << " GFLOP/s (model time " << model << "s), achieved "
+               << flops / total_seconds * 1e-9 << " GFLOP/s (" << 100 * model / total_seconds << "% of the roofline)\n";
+        report << "  time: " << compute_time << "s compute-bound (" << N - first_diag - memory_bound << " diagonals), "
+               << memory_time << "s memory-bound (" << memory_bound << " diagonals), " << overhead
+               << "s overhead over the model";
+        if (measured > 0)
+            report << " (" << measured << "s measured between diagonals)";
+        report << "\n  limited by: " << bound << "\n";
+        std::cout << report.str() << std::flush;
+    }
+
+private:
+    RooflineMachine machine;
+    uint64_t N;
+    uint64_t first_diag;
+    std::vector<double> done; // completion time of each diagonal, from start()
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+};
+
+#endif // ROOFLINE_WF_HPP
@@ -6,8 +6,9 @@
 #include <cmath>
 #include <chrono>
 #include <iomanip>
+#include "matrix_wf.hpp"
 
-void inline compute_stencil_naive(std::vector<std::vector<double>> &M, const uint64_t &N) {
+void inline compute_stencil_naive(Matrix &M, const uint64_t &N) {
     // naive implementation of the stencil computation, none of the optimizations are applied
     for(uint64_t diag = 1; diag < N; ++diag) {        // for each upper diagonal
         for(uint64_t i = 0; i < (N-diag); ++i) {      // for each elem. in the diagonal
@@ -20,7 +21,7 @@ void inline compute_stencil_naive(std::vector<std::vector<double>> &M, const uin
     }
 }
 
-void inline compute_stencil_temp(std::vector<std::vector<double>> &M, const uint64_t &N) {
+void inline compute_stencil_temp(Matrix &M, const uint64_t &N) {
     // here, we accumulate the result in a temporary variable, to avoid writing to the same memory location multiple times.
     // In a sequential program, this would not change much, but in a parallel program, it can be faster, avoiding false sharing.
     for(uint64_t diag = 1; diag < N; ++diag) {        // for each upper diagonal
@@ -35,7 +36,7 @@ void inline compute_stencil_temp(std::vector<std::vector<double>> &M, const uint
         }
     }
 }
-void inline compute_stencil_i_p_diag(std::vector<std::vector<double>> &M, const uint64_t &N) {
+void inline compute_stencil_i_p_diag(Matrix &M, const uint64_t &N) {
     // here we compute one time i_plus_diag =i+diag, that is used multiple times in the inner loop
     for(uint64_t diag = 1; diag < N; ++diag) {        // for each upper diagonal
         for(uint64_t i = 0; i < (N-diag); ++i) {      // for each elem. in the diagonal
@@ -50,7 +51,7 @@ void inline compute_stencil_i_p_diag(std::vector<std::vector<double>> &M, const
     }
 }
 
-void inline compute_stencil_optim(std::vector<std::vector<double>> &M, const uint64_t &N) {
+void inline compute_stencil_optim(Matrix &M, const uint64_t &N) {
     // here we compute the stencil in a more cache-friendly way, by storing the result in the lower triangle, and copying it to the upper triangle, 
     // in order to do a dot product over two rows, instead of a dot product between a row and a column.
     for(uint64_t diag = 1; diag < N; ++diag) {        // for each upper diagonal
@@ -68,4 +69,19 @@ void inline compute_stencil_optim(std::vector<std::vector<double>> &M, const uin
     }
 }
 
+void inline compute_diagonal_optim(Matrix &M, const uint64_t &N, const uint64_t &diag) {
+    // a single step of compute_stencil_optim, for callers that drive the loop over the diagonals themselves
+    // (e.g. to checkpoint or restart in the middle of the computation)
+    for(uint64_t i = 0; i < (N-diag); ++i) {      // for each elem. in the diagonal
+        auto i_plus_diag = i + diag;
+        double temp = 0.0;
+        for (uint64_t j = 0; j < diag; ++j) {     // for each elem. in the stencil
+            temp += M[i][i+j] * M[i_plus_diag][i_plus_diag -j];
+        }
+        temp = std::cbrt(temp); // cube root
+        M[i_plus_diag][i] = temp;
+        M[i][i_plus_diag] = temp;
+    }
+}
+
 #endif
\ No newline at end of file
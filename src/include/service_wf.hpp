@@ -0,0 +1,143 @@
+#ifndef SERVICE_WF_HPP
+#define SERVICE_WF_HPP
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// ------------------------------------------------------------------
+// ---------------------- WAVEFRONT SERVICE -------------------------
+// ------------------------------------------------------------------
+// Binary protocol of `wavefront_server` over a Unix domain (stream) socket. A connection carries any number of
+// requests, each answered in order. All the fields are in the byte order of the machine (the socket is local).
+//   request:  JobRequest, then N doubles (the initial diagonal) if flags has JOB_EXPLICIT_DIAGONAL,
+//             then n_outputs pairs of uint64 (i, j)
+//   response: JobResponse, then n_values doubles (M[i][j] for each pair requested, or M[0][N-1] if none),
+//             then path_length bytes (the result file, if flags has JOB_WRITE_RESULT)
+// A request with kind SERVICE_SHUTDOWN stops the server after the jobs in progress.
+
+constexpr uint32_t SERVICE_MAGIC = 0x31464a57; // "WJF1"
+
+enum ServiceKind : uint32_t { SERVICE_JOB = 0, SERVICE_SHUTDOWN = 1 };
+
+enum JobFlags : uint32_t {
+    JOB_EXPLICIT_DIAGONAL = 1, // the initial diagonal follows the request, else M[i][i] = (i+1)/N
+    JOB_WRITE_RESULT = 2,      // save the matrix as a result file (see result_wf.hpp) and return its path
+};
+
+struct JobRequest {
+    uint32_t magic = SERVICE_MAGIC;
+    uint32_t kind = SERVICE_JOB;
+    uint32_t flags = 0;
+    uint32_t n_outputs = 0;
+    uint64_t N = 0;
+};
+
+struct JobResponse {
+    uint32_t magic = SERVICE_MAGIC;
+    int32_t status = 0; // 0, or a negative errno-like code
+    uint64_t job_id = 0;
+    double queue_seconds = 0;   // waiting for the previous jobs
+    double compute_seconds = 0;
+    uint32_t n_values = 0;
+    uint32_t path_length = 0;
+};
+
+inline std::string service_socket_path() {
+    if (const char *path = std::getenv("WF_SERVICE_SOCKET"))
+        return path;
+    return "/tmp/wavefront.sock";
+}
+
+inline bool read_full(int fd, void *data, size_t bytes) {
+    char *p = static_cast<char *>(data);
+    while (bytes > 0) {
+        ssize_t n = read(fd, p, bytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+inline bool write_full(int fd, const void *data, size_t bytes) {
+    const char *p = static_cast<const char *>(data);
+    while (bytes > 0) {
+        ssize_t n = send(fd, p, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+inline sockaddr_un service_address(const std::string &path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+// a connection to the server, -1 on failure
+inline int service_connect(const std::string &path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    auto address = service_address(path);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct JobResult {
+    JobResponse response;
+    std::vector<double> values;
+    std::string path;
+};
+
+// sends a job and waits for its result; false if the connection failed, or if diagonal does not hold N elements
+// (then nothing is sent)
+inline bool service_submit(int fd, uint64_t N, const std::vector<std::pair<uint64_t, uint64_t>> &outputs,
+                           JobResult &result, const std::vector<double> *diagonal = nullptr, bool write_result = false) {
+    if (diagonal && diagonal->size() != N) return false;
+    JobRequest request;
+    request.N = N;
+    request.n_outputs = outputs.size();
+    request.flags = (diagonal ? JOB_EXPLICIT_DIAGONAL : 0) | (write_result ? JOB_WRITE_RESULT : 0);
+    std::vector<uint64_t> pairs;
+    for (auto [i, j] : outputs) {
+        pairs.push_back(i);
+        pairs.push_back(j);
+    }
+    if (!write_full(fd, &request, sizeof(request)) ||
+        (diagonal && !write_full(fd, diagonal->data(), N * sizeof(double))) ||
+        !write_full(fd, pairs.data(), pairs.size() * sizeof(uint64_t)))
+        return false;
+    if (!read_full(fd, &result.response, sizeof(result.response)) || result.response.magic != SERVICE_MAGIC)
+        return false;
+    result.values.resize(result.response.n_values);
+    result.path.resize(result.response.path_length);
+    return read_full(fd, result.values.data(), result.values.size() * sizeof(double)) &&
+           read_full(fd, result.path.data(), result.path.size());
+}
+
+// asks the server to stop
+inline bool service_shutdown(int fd) {
+    JobRequest request;
+    request.kind = SERVICE_SHUTDOWN;
+    JobResponse response;
+    return write_full(fd, &request, sizeof(request)) && read_full(fd, &response, sizeof(response));
+}
+
+#endif // SERVICE_WF_HPP
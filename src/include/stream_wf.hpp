@@ -0,0 +1,218 @@
+#ifndef STREAM_WF_HPP
+#define STREAM_WF_HPP
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include "matrix_wf.hpp"
+
+// ------------------------------------------------------------------
+// ----------------------- STREAMING DIAGONALS ----------------------
+// ------------------------------------------------------------------
+// The collector of the farms knows when a diagonal is final: with a DiagonalStream it hands the diagonal to a
+// consumer that runs on its own thread, concurrently with the computation of the next diagonals. The consumer
+// gets a view of the elements inside M, nothing is copied: a final diagonal is never written again, and the
+// workers only write the diagonals after it. At most `depth` diagonals wait for the consumer; when the queue is
+// full the collector waits, and with it the farm (backpressure), so a slow consumer cannot fall arbitrarily behind.
+// Enabled in the drivers with WF_STREAM:
+//   WF_STREAM=reduce        sum, minimum and maximum of each diagonal, printed at the end
+//   WF_STREAM=file:<file>   each diagonal appended to <file> as soon as it is final: diag, count (uint64),
+//                           then count doubles M[k][k+diag]
+//   WF_STREAM_DEPTH=<n>     diagonals that can wait for the consumer (default 8)
+// Other consumers implement DiagonalConsumer, or wrap a callback in a DiagonalCallback.
+
+// diagonal diag of M, without copies
+struct DiagonalView {
+    const Matrix *M;
+    uint64_t N;
+    uint64_t diag;
+    uint64_t size() const { return N - diag; }
+    double operator[](uint64_t k) const { return (*M)[k][k + diag]; }
+};
+
+class DiagonalConsumer {
+public:
+    virtual ~DiagonalConsumer() = default;
+    // called in order, diagonal by diagonal, on the thread of the stream
+    virtual void consume(const DiagonalView &diagonal) = 0;
+    // after the last diagonal
+    virtual void finish() {}
+};
+
+class DiagonalCallback: public DiagonalConsumer {
+public:
+    explicit DiagonalCallback(std::function<void(const DiagonalView &)> callback): callback(std::move(callback)) {}
+    void consume(const DiagonalView &diagonal) override { callback(diagonal); }
+
+private:
+    std::function<void(const DiagonalView &)> callback;
+};
+
+class DiagonalReduction: public DiagonalConsumer {
+public:
+    void consume(const DiagonalView &diagonal) override {
+        double sum = 0, lo = std::numeric_limits<double>::max(), hi = std::numeric_limits<double>::lowest();
+        for (uint64_t k = 0; k < diagonal.size(); ++k) {
+            double value = diagonal[k];
+            sum += value;
+            lo = std::min(lo, value);
+            hi = std::max(hi, value);
+        }
+        total += sum;
+        minimum = std::min(minimum, lo);
+        maximum = std::max(maximum, hi);
+        diagonals++;
+    }
+    void finish() override {
+        std::cout << "stream reduction: " << diagonals << " diagonals, sum " << total << ", min " << minimum << ", max "
+                  << maximum << std::endl;
+    }
+
+private:
+    uint64_t diagonals = 0;
+    double total = 0;
+    double minimum = std::numeric_limits<double>::max();
+    double maximum = std::numeric_limits<double>::lowest();
+};
+
+class DiagonalFileWriter: public DiagonalConsumer {
+public:
+    explicit DiagonalFileWriter(const std::string &filename) {
+        file = std::fopen(filename.c_str(), "wb");
+        if (file == nullptr) std::perror(("stream " + filename).c_str());
+    }
+    ~DiagonalFileWriter() override { finish(); }
+    void consume(const DiagonalView &diagonal) override {
+        if (file == nullptr) return;
+        // the diagonal is strided in M: gather it in a buffer reused by all the diagonals, for one large write
+        uint64_t record[2] = {diagonal.diag, diagonal.size()};
+        buffer.resize(diagonal.size());
+        for (uint64_t k = 0; k < diagonal.size(); ++k)
+            buffer[k] = diagonal[k];
+        std::fwrite(record, sizeof(record), 1, file);
+        std::fwrite(buffer.data(), sizeof(double), buffer.size(), file);
+    }
+    void finish() override {
+        if (file != nullptr) std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    FILE *file = nullptr;
+    std::vector<double> buffer;
+};
+
+struct StreamConfig {
+    std::string consumer; // "reduce", "file", or empty if streaming is disabled
+    std::string filename;
+    size_t depth = 8;
+};
+
+inline StreamConfig stream_config_from_env() {
+    StreamConfig config;
+    if (const char *stream = std::getenv("WF_STREAM")) {
+        std::string value = stream;
+        if (value == "reduce")
+            config.consumer = value;
+        else if (value.rfind("file:", 0) == 0) {
+            config.consumer = "file";
+            config.filename = value.substr(5);
+        } else if (!value.empty())
+            std::cout << "Warning: unknown WF_STREAM consumer " << value << ", streaming disabled" << std::endl;
+    }
+    if (const char *depth = std::getenv("WF_STREAM_DEPTH"))
+        config.depth = std::max(1L, std::atol(depth));
+    return config;
+}
+
+inline std::unique_ptr<DiagonalConsumer> make_diagonal_consumer(const StreamConfig &config) {
+    if (config.consumer == "reduce") return std::make_unique<DiagonalReduction>();
+    if (config.consumer == "file") return std::make_unique<DiagonalFileWriter>(config.filename);
+    return nullptr;
+}
+
+class DiagonalStream {
+public:
+    DiagonalStream(std::unique_ptr<DiagonalConsumer> consumer, const Matrix &M, uint64_t N, size_t depth = 8):
+        consumer(std::move(consumer)), M(M), N(N), depth(depth) {
+        consumer_thread = std::thread([this] { consume_loop(); });
+    }
+    ~DiagonalStream() { finish(); }
+    DiagonalStream(const DiagonalStream &) = delete;
+    DiagonalStream &operator=(const DiagonalStream &) = delete;
+
+    // diagonal diag is final (called in order by a single thread); waits while `depth` diagonals are queued
+    void push(uint64_t diag) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (queue.size() >= depth) {
+            auto start = std::chrono::steady_clock::now();
+            space.wait(lock, [&] { return queue.size() < depth; });
+            stall_seconds += std::chrono::steady_clock::now() - start;
+        }
+        queue.push_back(diag);
+        items.notify_one();
+    }
+
+    // consumes the diagonals still queued and stops the consumer
+    void finish() {
+        if (!consumer_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        items.notify_one();
+        consumer_thread.join();
+        consumer->finish();
+    }
+
+    void print_stats(double elapsed) const {
+        std::cout << "stream: " << consumed << " diagonals consumed, consumer busy " << busy_seconds.count()
+                  << "s, computation stalled " << stall_seconds.count() << "s by backpressure ("
+                  << 100.0 * stall_seconds.count() / elapsed << "% of the elapsed time)\n";
+    }
+
+private:
+    void consume_loop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            items.wait(lock, [&] { return stop || !queue.empty(); });
+            if (queue.empty()) return; // stop, and nothing left
+            uint64_t diag = queue.front();
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            consumer->consume(DiagonalView{&M, N, diag});
+            busy_seconds += std::chrono::steady_clock::now() - start;
+            consumed++;
+            lock.lock();
+            queue.pop_front(); // the slot is released only now: a queued diagonal counts until it is consumed
+            space.notify_one();
+        }
+    }
+
+    std::unique_ptr<DiagonalConsumer> consumer;
+    const Matrix &M;
+    uint64_t N;
+    size_t depth;
+    std::deque<uint64_t> queue;
+    std::mutex mtx;
+    std::condition_variable items, space;
+    bool stop = false;
+    uint64_t consumed = 0;
+    std::chrono::duration<double> busy_seconds{0};
+    std::chrono::duration<double> stall_seconds{0};
+    std::thread consumer_thread;
+};
+
+#endif // STREAM_WF_HPP
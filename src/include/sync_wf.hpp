@@ -0,0 +1,151 @@
+#ifndef SYNC_WF_HPP
+#define SYNC_WF_HPP
+
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/resource.h>
+
+// ------------------------------------------------------------------
+// ---------------------- FARM SYNCHRONIZATION ----------------------
+// ------------------------------------------------------------------
+// How the threads of the farms wait for the next diagonal, chosen with WF_SYNC:
+//   spin:     (default) FastFlow non-blocking mode, idle threads busy-wait on their queues
+//   block:    FastFlow blocking mode, idle threads sleep on a condition variable (a futex) right away
+//   adaptive: blocking mode, but before going to sleep each node spins on a counter that tells when its next
+//             input is coming (the next diagonal for the workers and the emitter, the next result for the
+//             collector). The spin lasts as long as the waits seen so far, if they are shorter than twice the
+//             cost of sleeping and being woken up (measured at startup); longer waits spin for just that cost
+//             and then sleep, so a wait never costs more than twice the best choice made in hindsight.
+// Short diagonals keep the latency of spinning, long (or unbalanced) ones give the cores back to other jobs.
+
+enum class SyncMode { spin, block, adaptive };
+
+inline SyncMode sync_mode_from_env() {
+    if (const char *mode = std::getenv("WF_SYNC")) {
+        std::string name = mode;
+        if (name == "block") return SyncMode::block;
+        if (name == "adaptive") return SyncMode::adaptive;
+    }
+    return SyncMode::spin;
+}
+
+inline const char *sync_mode_name(SyncMode mode) {
+    switch (mode) {
+    case SyncMode::block: return "block";
+    case SyncMode::adaptive: return "adaptive";
+    default: return "spin";
+    }
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// time to put a thread to sleep on a condition variable and wake it up, half of a ping-pong round trip
+inline double calibrate_park_cost_ns() {
+    constexpr int ROUNDS = 200;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int turn = 0;
+    std::thread partner([&] {
+        for (int r = 0; r < ROUNDS; ++r) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return turn == 1; });
+            turn = 0;
+            cv.notify_one();
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; ++r) {
+        std::unique_lock<std::mutex> lock(mutex);
+        turn = 1;
+        cv.notify_one();
+        cv.wait(lock, [&] { return turn == 0; });
+    }
+    auto end = std::chrono::steady_clock::now();
+    partner.join();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (2 * ROUNDS);
+}
+
+inline double park_cost_ns() {
+    static double cost = calibrate_park_cost_ns();
+    return cost;
+}
+
+// spin-then-block policy of one thread
+class AdaptiveSpin {
+public:
+    // spins until ready() returns true or the limit expires; returns ready()
+    template <typename F>
+    bool wait(F ready) {
+        if (park_ns == 0) limit_ns = park_ns = park_cost_ns();
+        auto start = std::chrono::steady_clock::now();
+        double waited = 0;
+        bool done = ready();
+        for (unsigned i = 1; !done; ++i) {
+            cpu_relax();
+            done = ready();
+            if (!done && i % 64 == 0) {
+                waited = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                if (waited > limit_ns) break;
+            }
+        }
+        if (done)
+            waited = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        // a wait that timed out lasted more than the limit: count it twice as long
+        average_ns = 0.75 * average_ns + 0.25 * (done ? waited : 2 * limit_ns);
+        limit_ns = average_ns < 2 * park_ns ? std::min(std::max(2 * average_ns, park_ns), MAX_SPIN_NS) : park_ns;
+        return done;
+    }
+
+private:
+    static constexpr double MAX_SPIN_NS = 200e3;
+    double park_ns = 0;
+    double limit_ns = 0;
+    double average_ns = 0;
+};
+
+struct alignas(64) SyncCounter {
+    std::atomic<size_t> value{0};
+};
+
+// counters shared by the nodes of a farm in adaptive mode, each on its own cache line
+struct FarmSync {
+    FarmSync() { park_cost_ns(); } // calibrate before the threads start
+    SyncCounter dispatched; // last diagonal sent to the workers
+    SyncCounter completed;  // last diagonal completed by the collector
+    SyncCounter results;    // results sent to the collector
+    SyncCounter tasks;      // tasks of the current diagonal (block-cyclic farm)
+    SyncCounter started;    // tasks of the current diagonal taken by the workers (block-cyclic farm)
+
+    // before the next job of a reused farm, with its threads frozen
+    void reset() {
+        for (auto counter : {&dispatched, &completed, &results, &tasks, &started})
+            counter->value.store(0, std::memory_order_relaxed);
+    }
+};
+
+// user + system time of the process, in seconds
+inline double cpu_seconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+inline void print_cpu_usage(SyncMode mode, double cpu, double wall) {
+    std::cout << "sync mode " << sync_mode_name(mode) << ": " << cpu << " CPU-seconds in " << wall << "s (" << cpu / wall
+              << " cores busy on average)" << std::endl;
+}
+
+#endif // SYNC_WF_HPP
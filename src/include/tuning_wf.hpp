@@ -0,0 +1,140 @@
+#ifndef TUNING_WF_HPP
+#define TUNING_WF_HPP
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+
+// ------------------------------------------------------------------
+// -------------------------- TUNING TABLES -------------------------
+// ------------------------------------------------------------------
+// The best configuration of each backend found by `autotune`, for each machine type (CPU model and number of
+// hardware threads) and range of N (powers of two: [2^k, 2^(k+1))). One entry per line:
+//   machine N_lo N_hi backend nworkers chunksize on_demand probe_seconds
+// The drivers look up their configuration here when they are run without explicit parameters.
+
+struct TuningConfig {
+    std::string backend;    // sequential, farm, block_cyclic, omp
+    int nworkers = 1;
+    size_t chunksize = 1;
+    bool on_demand = false;
+    double probe_seconds = 0; // time of the probe run that selected this configuration
+};
+
+struct TuningEntry {
+    std::string machine;
+    uint64_t N_lo;
+    uint64_t N_hi;
+    TuningConfig config;
+};
+
+inline std::string machine_key() {
+    std::string model = "unknown";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            model = line.substr(line.find(':') + 1);
+            break;
+        }
+    }
+    model.erase(0, model.find_first_not_of(' '));
+    std::replace(model.begin(), model.end(), ' ', '_');
+    return model + "/" + std::to_string(std::thread::hardware_concurrency());
+}
+
+inline std::string tuning_filename() {
+    if (const char *file = std::getenv("WF_TUNING_FILE"))
+        return file;
+    return "../results/tuning.txt";
+}
+
+// the range of N a size belongs to: [largest power of two <= N, twice that)
+inline std::pair<uint64_t, uint64_t> tuning_range(uint64_t N) {
+    uint64_t lo = 1;
+    while (lo * 2 <= N) lo *= 2;
+    return {lo, lo * 2};
+}
+
+inline std::vector<TuningEntry> read_tuning_file() {
+    std::vector<TuningEntry> entries;
+    std::ifstream file(tuning_filename());
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        TuningEntry entry;
+        int on_demand = 0;
+        if (fields >> entry.machine >> entry.N_lo >> entry.N_hi >> entry.config.backend >> entry.config.nworkers >>
+            entry.config.chunksize >> on_demand >> entry.config.probe_seconds) {
+            entry.config.on_demand = on_demand;
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+// adds the new entries to the tuning file, replacing the old ones for the same machine, range and backend
+inline bool save_tuning(const std::vector<TuningEntry> &new_entries) {
+    auto entries = read_tuning_file();
+    for (auto &new_entry : new_entries) {
+        auto same = [&](const TuningEntry &entry) {
+            return entry.machine == new_entry.machine && entry.N_lo == new_entry.N_lo && entry.config.backend == new_entry.config.backend;
+        };
+        entries.erase(std::remove_if(entries.begin(), entries.end(), same), entries.end());
+        entries.push_back(new_entry);
+    }
+    std::error_code error;
+    auto path = std::filesystem::path(tuning_filename());
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path(), error);
+    std::ofstream file(tuning_filename());
+    if (!file.is_open()) return false;
+    file << "# machine N_lo N_hi backend nworkers chunksize on_demand probe_seconds\n";
+    for (auto &entry : entries)
+        file << entry.machine << " " << entry.N_lo << " " << entry.N_hi << " " << entry.config.backend << " " << entry.config.nworkers
+             << " " << entry.config.chunksize << " " << int(entry.config.on_demand) << " " << entry.config.probe_seconds << "\n";
+    return bool(file);
+}
+
+// the tuned configuration for N on this machine (of the given backend, or the fastest backend if empty).
+// If N's range was not tuned, the closest tuned range is used. Returns false if this machine was never tuned
+inline bool lookup_tuning(uint64_t N, TuningConfig &config, const std::string &backend = "") {
+    auto machine = machine_key();
+    auto range = tuning_range(N);
+    bool found = false;
+    TuningEntry best;
+    double best_distance = 0;
+    for (auto &entry : read_tuning_file()) {
+        if (entry.machine != machine || (!backend.empty() && entry.config.backend != backend)) continue;
+        double distance = std::abs(std::log2(double(entry.N_lo)) - std::log2(double(range.first)));
+        bool better = !found || distance < best_distance;
+        if (found && distance == best_distance) // same range: faster backend, else prefer the larger range
+            better = entry.N_lo == best.N_lo ? entry.config.probe_seconds < best.config.probe_seconds : entry.N_lo > best.N_lo;
+        if (better) {
+            best = entry;
+            best_distance = distance;
+            found = true;
+        }
+    }
+    if (!found) return false;
+    config = best.config;
+    return true;
+}
+
+inline void print_tuning(const TuningConfig &config) {
+    std::cout << "using the tuned configuration: " << config.backend << ", " << config.nworkers << " workers";
+    if (config.backend == "block_cyclic")
+        std::cout << ", chunksize " << config.chunksize << (config.on_demand ? ", on demand" : ", round robin");
+    std::cout << std::endl;
+}
+
+#endif // TUNING_WF_HPP
@@ -0,0 +1,88 @@
+#include "incremental_wf.hpp"
+#include "omp_wf.hpp"
+#include "sequential_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s N [k value ...]\n", program_name);
+    std::printf("Computes the wavefront, then sets M[k][k] = value for each pair and recomputes only the elements that\n"
+                "depend on the changed entries (rows 0..k, columns k..N-1), comparing the time and the work with a run\n"
+                "from scratch.\n");
+    std::printf("     N: size of the square matrix\n");
+    std::printf("     k value: the edits of the main diagonal (default M[3N/4][3N/4] increased by 1%%)\n");
+    std::printf("With WF_VALIDATE=1 the result is compared with the sequential wavefront of the edited matrix.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc % 2 != 0 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")
+    {
+        show_help(argv[0]);
+        return argc < 2 || argc % 2 != 0 ? -1 : 0;
+    }
+    uint64_t N = std::stoull(argv[1]);
+    if (N < 2)
+    {
+        std::cout << "Error: N must be greater than 1" << std::endl;
+        return -1;
+    }
+    std::vector<std::pair<uint64_t, double>> edits;
+    for (int arg = 2; arg + 1 < argc; arg += 2)
+    {
+        uint64_t k = std::stoull(argv[arg]);
+        if (k >= N)
+        {
+            std::cout << "Error: " << k << " is out of the main diagonal" << std::endl;
+            return -1;
+        }
+        edits.push_back({k, std::stod(argv[arg + 1])});
+    }
+    if (edits.empty())
+        edits.push_back({3 * N / 4, 1.01 * double(3 * N / 4 + 1) / double(N)});
+
+    Matrix M(N, Row(N, 0.0));
+    for (uint64_t i = 0; i < N; ++i)
+        M[i][i] = double(i + 1) / double(N);
+    auto start = std::chrono::steady_clock::now();
+    compute_stencil_omp(M, N);
+    std::chrono::duration<double> full_seconds = std::chrono::steady_clock::now() - start;
+
+    IncrementalWavefront incremental(M, N);
+    start = std::chrono::steady_clock::now();
+    auto stats = incremental.update(edits);
+    std::chrono::duration<double> incremental_seconds = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setprecision(4);
+    std::cout << "full run: " << full_seconds.count() << "s, incremental update: " << incremental_seconds.count() << "s ("
+              << full_seconds.count() / incremental_seconds.count() << "x)\n";
+    std::cout << stats.edits << " diagonal entries changed, " << stats.elements << " of " << wavefront_elements_until(N, N - 1)
+              << " elements recomputed, " << stats.work << " of " << stats.full_work << " multiply-adds: "
+              << 100 * stats.saved() << "% of the work saved" << std::endl;
+    std::cout << std::setprecision(17) << "M[0][" << N - 1 << "] = " << M[0][N - 1] << std::endl;
+
+    const char *validate = std::getenv("WF_VALIDATE");
+    if (validate != nullptr && std::string(validate) != "0")
+    {
+        Matrix expected(N, Row(N, 0.0));
+        for (uint64_t i = 0; i < N; ++i)
+            expected[i][i] = M[i][i];
+        compute_stencil_optim(expected, N);
+        uint64_t wrong = 0;
+        for (uint64_t i = 0; i < N; ++i)
+            for (uint64_t j = i + 1; j < N; ++j)
+                if (std::abs(M[i][j] - expected[i][j]) > 1e-12 * std::max(1.0, std::abs(expected[i][j])))
+                    wrong++;
+        if (wrong == 0)
+            std::cout << "Validation passed: the update matches a run from scratch" << std::endl;
+        else
+            std::cout << "Validation FAILED: " << wrong << " elements differ from a run from scratch" << std::endl;
+        return wrong == 0 ? 0 : 1;
+    }
+    return 0;
+}
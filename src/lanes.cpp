@@ -0,0 +1,134 @@
+#include "lanes_wf.hpp"
+#include "sequential_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <string>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N_list, lanes, instances, filename]\n", program_name);
+    std::printf("Computes instances matrices of each size with random initial diagonals, once with compute_stencil_optim\n"
+                "on each matrix and once with the lane-interleaved kernel on groups of `lanes` matrices, checks that the\n"
+                "results are the same and prints the throughput of both, per instance.\n");
+    std::printf("     N_list: sizes of the matrices, separated by commas (default 64,128,256,512,1024)\n");
+    std::printf("     lanes: matrices computed together, 4 or 8 (default 8)\n");
+    std::printf("     instances: matrices of each size, rounded up to a multiple of lanes (default 16)\n");
+    std::printf("     filename: name of the file to append the results to (default None, results are just printed)\n");
+}
+
+// seconds for all the instances with the lane kernel; the largest relative difference from the reference is
+// accumulated in max_error
+template <int L>
+double run_lanes(uint64_t N, const std::vector<std::vector<double>> &diagonals, const std::vector<Matrix> &reference,
+                 double &max_error)
+{
+    double seconds = 0;
+    for (size_t first = 0; first < diagonals.size(); first += L)
+    {
+        LaneMatrix<L> M(N);
+        for (int lane = 0; lane < L; ++lane)
+            M.set_diagonal(lane, diagonals[first + lane]);
+        auto start = std::chrono::steady_clock::now();
+        compute_stencil_lanes(M);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        seconds += elapsed.count();
+        for (int lane = 0; lane < L; ++lane)
+            for (uint64_t i = 0; i < N; ++i)
+                for (uint64_t j = i + 1; j < N; ++j)
+                    max_error = std::max(max_error, std::abs(M.get(lane, i, j) / reference[first + lane][i][j] - 1));
+    }
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<uint64_t> sizes = {64, 128, 256, 512, 1024};
+    int lanes = 8;
+    size_t instances = 16;
+    std::string filename;
+    if (argc > 5 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 5 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        sizes.clear();
+        std::stringstream list(argv[1]);
+        std::string size;
+        while (std::getline(list, size, ','))
+            sizes.push_back(std::stoull(size));
+    }
+    if (argc > 2)
+    {
+        lanes = std::stoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        instances = std::stoul(argv[3]);
+    }
+    if (argc > 4)
+    {
+        filename = argv[4];
+    }
+    if (lanes != 4 && lanes != 8)
+    {
+        std::cout << "Error: lanes must be 4 or 8" << std::endl;
+        return -1;
+    }
+    if (sizes.empty() || instances < 1)
+    {
+        std::cout << "Error: N_list and instances must not be empty or 0" << std::endl;
+        return -1;
+    }
+    instances = (instances + lanes - 1) / lanes * lanes;
+
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<double> distribution(0.01, 1.0);
+    bool valid = true;
+    std::cout << std::setprecision(4);
+    for (auto N : sizes)
+    {
+        std::vector<std::vector<double>> diagonals(instances, std::vector<double>(N));
+        for (auto &diagonal : diagonals)
+            for (auto &value : diagonal)
+                value = distribution(generator);
+
+        std::vector<Matrix> reference;
+        double optim_seconds = 0;
+        for (auto &diagonal : diagonals)
+        {
+            reference.emplace_back(N, Row(N, 0.0));
+            Matrix &M = reference.back();
+            for (uint64_t i = 0; i < N; ++i)
+                M[i][i] = diagonal[i];
+            auto start = std::chrono::steady_clock::now();
+            compute_stencil_optim(M, N);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            optim_seconds += elapsed.count();
+        }
+
+        double max_error = 0;
+        double lanes_seconds = lanes == 4 ? run_lanes<4>(N, diagonals, reference, max_error)
+                                          : run_lanes<8>(N, diagonals, reference, max_error);
+        valid = valid && max_error < 1e-12;
+        std::cout << "N = " << N << ": compute_stencil_optim " << instances / optim_seconds << " instances/s, " << lanes
+                  << " lanes " << instances / lanes_seconds << " instances/s (" << optim_seconds / lanes_seconds
+                  << "x), largest relative difference " << max_error << std::endl;
+        if (!filename.empty())
+        {
+            std::ofstream file(filename, std::ios_base::app);
+            file << N << " " << lanes << " " << instances << " " << optim_seconds << " " << lanes_seconds << std::endl;
+        }
+    }
+    if (!valid)
+    {
+        std::cout << "Error: the lane kernel does not compute the same matrices" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -1,4 +1,12 @@
 #include "farm_wf.hpp"
+#include "checkpoint_wf.hpp"
+#include "result_wf.hpp"
+#include "reference_wf.hpp"
+#include "progress_wf.hpp"
+#include "roofline_wf.hpp"
+#include "tuning_wf.hpp"
+#include "sync_wf.hpp"
+#include "stream_wf.hpp"
 #include <chrono>
 #include <iostream>
 #include <iomanip>
@@ -10,11 +18,11 @@ void show_help(const char *program_name)
                 "This version divides work between the workers with a static block distribution. \n");
 
     std::printf("     N: size of the square matrix (default 2048)\n");
-    std::printf("     nworkers: number of workers (default 4)\n");
+    std::printf("     nworkers: number of workers (default 4, or the tuned value if autotune was run on this machine)\n");
     std::printf("     filename: name of the file to write the results to (default None, results are just printed to the console)\n");
 }
 
-void print_matrix(std::vector<std::vector<double>> &M)
+void print_matrix(Matrix &M)
 {
     for (size_t i = 0; i < M.size(); i++)
     {
@@ -56,6 +64,13 @@ int main(int argc, char *argv[])
     {
         filename = argv[3];
     }
+    // without an explicit number of workers, use the one found by autotune for this machine and N
+    TuningConfig tuned;
+    if (argc <= 2 && lookup_tuning(N, tuned, "farm"))
+    {
+        nworkers = tuned.nworkers;
+        print_tuning(tuned);
+    }
 
     if (N < 1)
     {
@@ -79,24 +94,77 @@ int main(int argc, char *argv[])
         std::cout << "Warning: chunksize * nworkers must be less than N, defaulting to N/nworkers = " << chunksize << std::endl;
     }
 
-    std::vector<std::vector<double>> M(N, std::vector<double>(N, 0.0));
+    Matrix M(N, Row(N, 0.0));
 
     for (uint64_t i = 0; i < N; ++i)
     {
         M[i][i] = double(i + 1) / double(N);
     }
 
+    // restart from the checkpoint, if there is one
+    auto checkpoint_config = checkpoint_config_from_env();
+    uint64_t last_diag = 0;
+    if (!checkpoint_config.filename.empty()) {
+        last_diag = load_checkpoint(checkpoint_config.filename, M, N);
+        if (last_diag > 0)
+            std::cout << "Restarting from diagonal " << last_diag + 1 << std::endl;
+    }
+    std::unique_ptr<CheckpointWriter> checkpoint;
+    std::function<void(size_t)> on_diagonal_done = nullptr;
+    if (!checkpoint_config.filename.empty())
+        checkpoint = std::make_unique<CheckpointWriter>(checkpoint_config, M, N, last_diag);
+    std::unique_ptr<RooflineReport> roofline;
+    if (roofline_enabled())
+        roofline = std::make_unique<RooflineReport>(probe_machine(nworkers), N, last_diag + 1);
+    // hand each diagonal to the consumer as soon as it is final (the restored ones first)
+    auto stream_config = stream_config_from_env();
+    std::unique_ptr<DiagonalStream> stream;
+    if (auto consumer = make_diagonal_consumer(stream_config)) {
+        stream = std::make_unique<DiagonalStream>(std::move(consumer), M, N, stream_config.depth);
+        for (uint64_t diag = 1; diag <= last_diag; ++diag)
+            stream->push(diag);
+    }
+    if (checkpoint || roofline || stream) {
+        on_diagonal_done = [&](size_t diag) { // runs in the collector
+            if (checkpoint) checkpoint->diagonal_done(diag);
+            if (roofline) roofline->diagonal_done(diag);
+            if (stream) stream->push(diag);
+        };
+    }
+    auto progress_config = progress_config_from_env();
+    std::unique_ptr<ProgressMonitor> progress;
+    if (!progress_config.filename.empty())
+        progress = std::make_unique<ProgressMonitor>(progress_config, N, nworkers, last_diag + 1);
+    auto sync_mode = sync_mode_from_env();
+
     auto start = std::chrono::steady_clock::now();
-    compute_stencil_par(M, N, nworkers);
+    double cpu_start = cpu_seconds();
+    if (roofline) roofline->start();
+    compute_stencil_par(M, N, nworkers, false, last_diag + 1, on_diagonal_done, progress.get(), sync_mode);
+    if (progress) progress->finish();
+    if (checkpoint) checkpoint->finish();
+    if (stream) stream->finish();
     auto end = std::chrono::steady_clock::now();
     std::chrono::duration<double> elapsed_seconds = end - start;
+    double cpu_used = cpu_seconds() - cpu_start;
+    if (checkpoint) checkpoint->print_stats(elapsed_seconds.count());
+    if (stream) stream->print_stats(elapsed_seconds.count());
     std::cout << "elapsed time: " << elapsed_seconds.count() << "s\n";
+    print_cpu_usage(sync_mode, cpu_used, elapsed_seconds.count());
+    if (roofline) roofline->print(elapsed_seconds.count(), "farm");
     // write time taken, number of workers, chunksize, and N to a file
     std::ofstream file;
     file.open(filename, std::ios_base::app);
     file << N << " " << nworkers << " " << elapsed_seconds.count() << std::endl;
     file.close();
 
+    if (validation_enabled() && !validate(M, N, "farm"))
+        return -1;
+
+    auto result_config = result_config_from_env();
+    if (!result_config.filename.empty())
+        write_result(result_config, M, N);
+
     // print the matrix
     std::cout << M[0][N-1]<<std::endl;
     return 0;
@@ -1,4 +1,12 @@
 #include "farm_block_cyclic.hpp"
+#include "checkpoint_wf.hpp"
+#include "result_wf.hpp"
+#include "reference_wf.hpp"
+#include "progress_wf.hpp"
+#include "roofline_wf.hpp"
+#include "tuning_wf.hpp"
+#include "sync_wf.hpp"
+#include "stream_wf.hpp"
 #include <chrono>
 #include <iostream>
 
@@ -33,6 +41,14 @@ int main(int argc, char *argv[]) {
     if(argc >5){
         filename = argv[5];
     }
+    // without explicit parameters, use the ones found by autotune for this machine and N
+    TuningConfig tuned;
+    if(argc <= 2 && lookup_tuning(N, tuned, "block_cyclic")) {
+        nworkers = tuned.nworkers;
+        chunksize = tuned.chunksize;
+        on_demand = tuned.on_demand;
+        print_tuning(tuned);
+    }
 
     if(N < 1) {
         std::cout << "Error: N must be greater than 0" << std::endl;
@@ -47,28 +63,81 @@ int main(int argc, char *argv[]) {
         return -1;
     }
     if(chunksize * nworkers > N) {
-        chunksize = size_t(N/nworkers);
+        chunksize = std::max<size_t>(1, N/nworkers);
 
         std::cout << "Warning: chunksize * nworkers must be less than N, defaulting to N/nworkers = "<< chunksize << std::endl;
     }
 
-    std::vector<std::vector<double>> M(N, std::vector<double>(N, 0.0));
+    Matrix M(N, Row(N, 0.0));
 
     for(uint64_t i = 0; i < N; ++i) {
         M[i][i] = double(i+1)/double(N);
     }
 
+    // restart from the checkpoint, if there is one
+    auto checkpoint_config = checkpoint_config_from_env();
+    uint64_t last_diag = 0;
+    if (!checkpoint_config.filename.empty()) {
+        last_diag = load_checkpoint(checkpoint_config.filename, M, N);
+        if (last_diag > 0)
+            std::cout << "Restarting from diagonal " << last_diag + 1 << std::endl;
+    }
+    std::unique_ptr<CheckpointWriter> checkpoint;
+    std::function<void(size_t)> on_diagonal_done = nullptr;
+    if (!checkpoint_config.filename.empty())
+        checkpoint = std::make_unique<CheckpointWriter>(checkpoint_config, M, N, last_diag);
+    std::unique_ptr<RooflineReport> roofline;
+    if (roofline_enabled())
+        roofline = std::make_unique<RooflineReport>(probe_machine(nworkers), N, last_diag + 1);
+    // hand each diagonal to the consumer as soon as it is final (the restored ones first)
+    auto stream_config = stream_config_from_env();
+    std::unique_ptr<DiagonalStream> stream;
+    if (auto consumer = make_diagonal_consumer(stream_config)) {
+        stream = std::make_unique<DiagonalStream>(std::move(consumer), M, N, stream_config.depth);
+        for (uint64_t diag = 1; diag <= last_diag; ++diag)
+            stream->push(diag);
+    }
+    if (checkpoint || roofline || stream) {
+        on_diagonal_done = [&](size_t diag) { // runs in the collector
+            if (checkpoint) checkpoint->diagonal_done(diag);
+            if (roofline) roofline->diagonal_done(diag);
+            if (stream) stream->push(diag);
+        };
+    }
+    auto progress_config = progress_config_from_env();
+    std::unique_ptr<ProgressMonitor> progress;
+    if (!progress_config.filename.empty())
+        progress = std::make_unique<ProgressMonitor>(progress_config, N, nworkers, last_diag + 1);
+    auto sync_mode = sync_mode_from_env();
+
     auto start = std::chrono::steady_clock::now();
-    compute_stencil_par(M, N, nworkers, chunksize, on_demand);
+    double cpu_start = cpu_seconds();
+    if (roofline) roofline->start();
+    block_cyclic::compute_stencil_par(M, N, nworkers, chunksize, on_demand, last_diag + 1, on_diagonal_done, progress.get(), sync_mode);
+    if (progress) progress->finish();
+    if (checkpoint) checkpoint->finish();
+    if (stream) stream->finish();
     auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> elapsed_seconds = end-start;
+    std::chrono::duration<double> elapsed_seconds = end - start;
+    double cpu_used = cpu_seconds() - cpu_start;
+    if (checkpoint) checkpoint->print_stats(elapsed_seconds.count());
+    if (stream) stream->print_stats(elapsed_seconds.count());
     std::cout << "elapsed time: " << elapsed_seconds.count() << "s\n";
+    print_cpu_usage(sync_mode, cpu_used, elapsed_seconds.count());
+    if (roofline) roofline->print(elapsed_seconds.count(), "block-cyclic farm");
     // write time taken, number of workers, chunksize, and N to a file
     std::ofstream file;
     file.open("../results/"+filename, std::ios_base::app);
     file << N << " " << nworkers << " " <<  " "  << chunksize << " "  << int(on_demand)<< " " << elapsed_seconds.count() << std::endl;
     file.close();
 
+    if (validation_enabled() && !validate(M, N, "block-cyclic farm"))
+        return -1;
+
+    auto result_config = result_config_from_env();
+    if (!result_config.filename.empty())
+        write_result(result_config, M, N);
+
     return 0;
 }
 
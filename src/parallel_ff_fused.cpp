@@ -0,0 +1,90 @@
+#include "farm_wf.hpp"
+#include <chrono>
+#include <iostream>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N, nworkers, k, filename]\n", program_name);
+    std::printf("Computes the wavefront of a matrix of size N with the FastFlow farm of parallel_ff, synchronizing through the collector\n"
+                "once per diagonal and once every k diagonals (fused supersteps), and compares the two.\n");
+    std::printf("     N: size of the square matrix (default 2048)\n");
+    std::printf("     nworkers: number of workers (default 4)\n");
+    std::printf("     k: diagonals per superstep (default 8)\n");
+    std::printf("     filename: name of the file to write the results to (default fused_results.txt)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t N = 2048; // default size of the matrix (NxN)
+    int nworkers = 4;  // default number of workers
+    size_t k = 8;      // default number of diagonals per superstep
+    std::string filename = "fused_results.txt";
+    if (argc > 5 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 5 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        N = std::stol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        nworkers = std::stol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        k = std::stol(argv[3]);
+    }
+    if (argc > 4)
+    {
+        filename = argv[4];
+    }
+    if (N < 2 || nworkers < 1 || k < 1)
+    {
+        std::cout << "Error: N must be greater than 1, nworkers and k greater than 0" << std::endl;
+        return -1;
+    }
+
+    Matrix M(N, Row(N, 0.0));
+    for (uint64_t i = 0; i < N; ++i)
+    {
+        M[i][i] = double(i + 1) / double(N);
+    }
+    auto M1 = M;
+
+    auto start = std::chrono::steady_clock::now();
+    compute_stencil_par(M, N, nworkers);
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - start;
+
+    start = std::chrono::steady_clock::now();
+    size_t supersteps = compute_stencil_par_fused(M1, N, nworkers, k);
+    end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed_seconds_fused = end - start;
+
+    for (uint64_t i = 0; i < N; ++i)
+    {
+        for (uint64_t j = i; j < N; ++j)
+        {
+            if (std::abs(M[i][j] - M1[i][j]) > 1e-6)
+            {
+                std::cout << "Error: M[" << i << "][" << j << "] = " << M[i][j] << " != " << M1[i][j] << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    std::cout << "one diagonal per round trip: " << N - 1 << " round trips, elapsed time: " << elapsed_seconds.count() << "s\n";
+    std::cout << "k = " << k << ": " << supersteps << " round trips (" << double(N - 1) / supersteps << "x fewer), elapsed time: "
+              << elapsed_seconds_fused.count() << "s, speedup " << elapsed_seconds.count() / elapsed_seconds_fused.count() << "\n";
+
+    // write N, number of workers, k, round trips and both times to a file
+    std::ofstream file;
+    file.open(filename, std::ios_base::app);
+    file << N << " " << nworkers << " " << k << " " << supersteps << " " << elapsed_seconds.count() << " " << elapsed_seconds_fused.count() << std::endl;
+    file.close();
+
+    std::cout << M1[0][N - 1] << std::endl;
+    return 0;
+}
@@ -8,10 +8,15 @@
 #include <chrono>
 #include <unistd.h> 
 #include <fstream>
+#include "checkpoint_wf.hpp"
+#include "result_wf.hpp"
+#include "reference_wf.hpp"
+#include "progress_wf.hpp"
+#include "mpi_shared_wf.hpp"
 
 using namespace std;
 
-void print_matrix(vector<vector<double>> &M){
+void print_matrix(Matrix &M){
     for (size_t i = 0; i < M.size(); i++){
         for (size_t j = 0; j < M.size(); j++){
             // cout << M[i][j] << " "; with 2 decimal points
@@ -35,7 +40,12 @@ start_end compute_start_end(int rank, int size, size_t N) {
     return se;
 }
 
-void compute_internal_part(start_end se, size_t diag, vector<vector<double>> &M, size_t N) {
+// the stores to the node matrix must be synchronized around the barriers, private matrices need nothing
+void sync_matrix(Matrix &) {}
+void sync_matrix(SharedMatrix &M) { M.sync(); }
+
+template <typename MatrixT>
+void compute_internal_part(start_end se, size_t diag, MatrixT &M, size_t N) {
     if (se.start + 1 > se.end) return;
     #pragma omp parallel for // parallelize the computation of the internal part
     for (auto row = se.start + 1; row < se.end; row++) {
@@ -50,11 +60,12 @@ void compute_internal_part(start_end se, size_t diag, vector<vector<double>> &M,
     }
 }
 
+template <typename MatrixT>
 void check_first(
     start_end se,
     size_t diag,
     size_t N,
-    vector<vector<double>> &M,
+    MatrixT &M,
     int rank,
     MPI_Request requests[2],
     bool * need_row,
@@ -74,11 +85,12 @@ void check_first(
     }
 }
 
+template <typename MatrixT>
 void check_last( 
     start_end se,
     size_t diag,
     size_t N, 
-    vector<vector<double>> &M, 
+    MatrixT &M, 
     int rank, 
     MPI_Request requests[2], 
     bool *need_col,
@@ -97,30 +109,229 @@ void check_last(
     }
 }
 
-int main(int argc, char *argv[]){
-    MPI_Init(&argc, &argv);
-    auto start = chrono::high_resolution_clock::now();
-    int rank, size;
+// elements computed by this rank before the tail: the rows of a rank shift towards the top as the diagonals get
+// shorter, so for each row they are the contiguous range of diagonals first[row]..last[row] (empty if first > last)
+void owned_diagonals(size_t N, int rank, int size, size_t tail, vector<size_t> &first, vector<size_t> &last) {
+    first.assign(N, N);
+    last.assign(N, 0);
+    for (size_t diag = 0; diag < tail && size_t(rank) < N - diag; diag++) {
+        auto se = compute_start_end(rank, size, N - diag);
+        for (auto row = se.start; row <= se.end; row++) {
+            first[row] = min(first[row], diag);
+            last[row] = diag;
+        }
+    }
+}
 
-    // argument check
-    if (argc < 2) {
-        cout << "Usage: " << argv[0] << " N" << "[filename]" << endl;
-        return 1;
+// the rank that computes element (row, row+diag) before the tail, as assigned by compute_start_end
+int owner_of(size_t N, int size, size_t row, size_t diag) {
+    size_t base = (N - diag) / size, remainder = (N - diag) % size;
+    if (row < remainder * (base + 1)) return row / (base + 1);
+    return remainder + (row - remainder * (base + 1)) / base;
+}
+
+// the diagonals tail..N-1 (the tail) are all computed by rank 0: the diagonals of the row, empty if first > last
+start_end tail_diagonals(size_t N, size_t tail, size_t row) {
+    return {tail, row + tail < N ? N - 1 - row : 0};
+}
+
+// ------------------------------------------------------------------
+// ------------------------ TAIL AGGLOMERATION ----------------------
+// ------------------------------------------------------------------
+// Once the diagonals are shorter than WF_MPI_TAIL elements (default: the number of ranks), the ranks would mostly
+// wait on the barrier and on the messages of one or two elements each. Instead the inputs of the remaining
+// triangle are gathered on rank 0, which computes it alone with its threads. WF_MPI_AGGLOMERATE=0 computes the
+// tail distributed as the rest (only the last element is computed on rank 0), to compare the two.
+
+struct TailConfig {
+    size_t threshold;
+    bool agglomerate = true;
+};
+
+TailConfig tail_config_from_env(int size) {
+    TailConfig config{size_t(size)};
+    if (const char *threshold = getenv("WF_MPI_TAIL"))
+        config.threshold = max<size_t>(1, strtoull(threshold, nullptr, 10));
+    if (const char *agglomerate = getenv("WF_MPI_AGGLOMERATE"))
+        config.agglomerate = string(agglomerate) != "0";
+    return config;
+}
+
+// the elements before the tail that the tail reads are the rows 0..N-1-tail and the columns tail..N-1:
+// in each row, the diagonals first..last (N (N-tail) elements at most, instead of N^2/2)
+start_end tail_inputs(size_t N, size_t tail, size_t row) {
+    return {row + tail <= N - 1 || row >= tail ? 0 : tail - row, min(tail - 1, N - 1 - row)};
+}
+
+// rank 0 receives the inputs of the tail computed by the other ranks, unless they share its matrix.
+// Each rank sends a (row, first diagonal, count) header per row, then the elements of all the rows
+template <typename MatrixT>
+void gather_tail_inputs(MatrixT &M, size_t N, size_t tail, int rank, int size, const NodeTopology &topology) {
+    vector<uint64_t> headers;
+    vector<double> values;
+    if (rank != 0 && !topology.same_node(rank, 0)) {
+        for (size_t row = 0; row < N; row++) {
+            auto inputs = tail_inputs(N, tail, row);
+            uint64_t begin = N, count = 0; // the diagonals of a row computed by a rank are contiguous
+            for (size_t diag = inputs.start; diag <= inputs.end; diag++) {
+                if (owner_of(N, size, row, diag) != rank) continue;
+                if (count == 0) begin = diag;
+                values.push_back(M[row][row + diag]);
+                count++;
+            }
+            if (count > 0) headers.insert(headers.end(), {row, begin, count});
+        }
     }
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-    if (rank == 0)
-        std::cout << "using " << size << " processes" <<std::endl;
+    int sizes[2] = {int(headers.size()), int(values.size())};
+    vector<int> all_sizes(2 * size);
+    MPI_Gather(sizes, 2, MPI_INT, all_sizes.data(), 2, MPI_INT, 0, MPI_COMM_WORLD);
+    vector<int> header_counts(size), value_counts(size), header_offsets(size, 0), value_offsets(size, 0);
+    for (int r = 0; r < size; r++) {
+        header_counts[r] = all_sizes[2 * r];
+        value_counts[r] = all_sizes[2 * r + 1];
+        if (r > 0) {
+            header_offsets[r] = header_offsets[r - 1] + header_counts[r - 1];
+            value_offsets[r] = value_offsets[r - 1] + value_counts[r - 1];
+        }
+    }
+    vector<uint64_t> all_headers(rank == 0 ? header_offsets[size - 1] + header_counts[size - 1] : 0);
+    vector<double> all_values(rank == 0 ? value_offsets[size - 1] + value_counts[size - 1] : 0);
+    MPI_Gatherv(headers.data(), sizes[0], MPI_UINT64_T, all_headers.data(), header_counts.data(), header_offsets.data(),
+                MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(values.data(), sizes[1], MPI_DOUBLE, all_values.data(), value_counts.data(), value_offsets.data(),
+                MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (rank != 0) return;
+    size_t v = 0;
+    for (size_t h = 0; h < all_headers.size(); h += 3) {
+        auto row = all_headers[h], begin = all_headers[h + 1], count = all_headers[h + 2];
+        for (auto diag = begin; diag < begin + count; diag++, v++) {
+            M[row][row + diag] = all_values[v];
+            M[row + diag][row] = all_values[v];
+        }
+    }
+}
 
-    if (size < 2) {
-        // abort if there is only one process
-        cout << "This program is meant to be run with at least 2 processes" << endl;
-        MPI_Finalize();
-        return 1;
+// the diagonals tail..N-1 on rank 0, all the inputs in place: threaded in parallel_mpi_omp (built with -fopenmp),
+// on a single thread in parallel_mpi
+template <typename MatrixT>
+void compute_tail(MatrixT &M, size_t N, size_t tail, ProgressMonitor *progress) {
+    for (size_t diag = tail; diag < N; diag++) {
+        ProgressTimer timer(progress, 0);
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (size_t row = 0; row < N - diag; row++) {
+            auto col = row + diag;
+            double temp = 0;
+            for (size_t j = 0; j < diag; j++) {
+                temp += M[row][row + j] * M[col][col - j];
+            }
+            temp = cbrt(temp);
+            M[col][row] = temp;
+            M[row][col] = temp;
+        }
+        timer.stop();
+        if (progress) progress->diagonal_done(diag);
     }
-    
-    size_t N = atoi(argv[1]);
-    vector<vector<double>> M(N, vector<double>(N, -1));
+}
+
+// validates the distributed result against the cached reference: each rank fingerprints the elements it computed,
+// and the fingerprints are reduced on rank 0 (sums add up, min and max reduce)
+template <typename MatrixT>
+bool validate_mpi(MatrixT &M, size_t N, int rank, int size, size_t tail) {
+    vector<size_t> first, last;
+    owned_diagonals(N, rank, size, tail, first, last);
+    vector<DiagonalFingerprint> fingerprints(N);
+    for (size_t row = 0; row < N; row++) {
+        for (size_t diag = first[row]; diag <= last[row] && diag < N; diag++) {
+            add_to_fingerprint(fingerprints[diag], row, diag, M[row][row + diag]);
+        }
+        auto tail_diags = tail_diagonals(N, tail, row);
+        for (size_t diag = tail_diags.start; rank == 0 && diag <= tail_diags.end; diag++) {
+            add_to_fingerprint(fingerprints[diag], row, diag, M[row][row + diag]);
+        }
+    }
+    vector<uint64_t> counts(N), total_counts(N);
+    vector<double> sums(3 * N), total_sums(3 * N), mins(N), total_mins(N), maxs(N), total_maxs(N);
+    for (size_t diag = 0; diag < N; diag++) {
+        counts[diag] = fingerprints[diag].count;
+        sums[3 * diag] = fingerprints[diag].sum;
+        sums[3 * diag + 1] = fingerprints[diag].weighted_sum;
+        sums[3 * diag + 2] = fingerprints[diag].abs_sum;
+        mins[diag] = fingerprints[diag].min;
+        maxs[diag] = fingerprints[diag].max;
+    }
+    MPI_Reduce(counts.data(), total_counts.data(), N, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(sums.data(), total_sums.data(), 3 * N, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(mins.data(), total_mins.data(), N, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(maxs.data(), total_maxs.data(), N, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    int ok = 1;
+    if (rank == 0) {
+        for (size_t diag = 0; diag < N; diag++) {
+            fingerprints[diag] = {total_counts[diag], total_sums[3 * diag], total_sums[3 * diag + 1], total_sums[3 * diag + 2],
+                                  total_mins[diag], total_maxs[diag]};
+        }
+        ok = report_validation(compare_fingerprints(fingerprints, get_reference(N)), "MPI");
+    }
+    MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return ok;
+}
+
+// every rank writes the elements it computed to the shared result file, one write per row
+template <typename MatrixT>
+void write_result_mpi(const ResultConfig &config, MatrixT &M, size_t N, int rank, int size, size_t tail) {
+    auto start = chrono::steady_clock::now();
+    vector<size_t> first, last;
+    owned_diagonals(N, rank, size, tail, first, last);
+
+    if (rank == 0) { // create the file with its final size
+        int fd = open(config.filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, RESULT_DATA_OFFSET + result_elements(N) * config.precision) != 0)
+            perror(("result " + config.filename).c_str());
+        if (fd >= 0) close(fd);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    int fd = open(config.filename.c_str(), O_WRONLY);
+    uint64_t checksum = 0;
+    vector<char> buffer(N * config.precision);
+    bool ok = fd >= 0;
+    auto write_range = [&](size_t row, size_t first, size_t last) {
+        if (first > last) return;
+        auto count = last - first + 1;
+        auto index = result_packed_index(N, row, row + first);
+        checksum += result_pack(&M[row][row + first], count, index, config.precision, buffer.data());
+        ok = pwrite(fd, buffer.data(), count * config.precision, RESULT_DATA_OFFSET + index * config.precision) == ssize_t(count * config.precision);
+    };
+    for (size_t row = 0; row < N && ok; row++) {
+        write_range(row, first[row], last[row]);
+        if (rank == 0 && ok) {
+            auto tail_diags = tail_diagonals(N, tail, row);
+            write_range(row, tail_diags.start, tail_diags.end);
+        }
+    }
+    if (!ok) perror(("result " + config.filename).c_str());
+
+    uint64_t total_checksum = 0;
+    MPI_Reduce(&checksum, &total_checksum, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD); // the checksum terms just add up
+    if (rank == 0 && fd >= 0) {
+        ResultHeader header = make_result_header(N, config.precision, total_checksum);
+        if (pwrite(fd, &header, sizeof(header), 0) != ssize_t(sizeof(header)))
+            perror(("result " + config.filename).c_str());
+    }
+    if (fd >= 0) close(fd);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << "result written to " << config.filename << " in " << elapsed.count() << "s" << endl;
+    }
+}
+
+// the wavefront on M, a private matrix per rank or the matrix shared by the ranks of the node.
+// Returns false if the validation failed
+template <typename MatrixT>
+bool run_wavefront(MatrixT &M, size_t N, int rank, int size, const NodeTopology &topology, int argc, char *argv[],
+                   chrono::high_resolution_clock::time_point start){
     auto se = compute_start_end(rank, size, N);
 
     for (size_t row = se.start; row <= se.end; row++) {
@@ -138,28 +349,85 @@ int main(int argc, char *argv[]){
     }   
     bool need_row = false;
     bool need_col = false; // these get set to true when in the two if, the operation is a receive.
+    // neighbours on the same node read each other's elements from the shared matrix, no messages
+    bool share_previous = rank > 0 && topology.same_node(rank, rank - 1);
+    bool share_next = rank + 1 < size && topology.same_node(rank, rank + 1);
+
+    // restart from the per-rank checkpoints, if there are any: every rank resumes after the last diagonal
+    // persisted by all of them. Diagonals before it are taken from all the files (so each rank has the rows/columns
+    // it would have received), the last one only from this rank's file, because the protocol uses the
+    // missing (-1) elements of the previous diagonal to decide who sends and who receives.
+    // With a shared matrix, the first rank of the node loads the last diagonal from the files of all the node's ranks
+    auto checkpoint_config = checkpoint_config_from_env(rank);
+    uint64_t last_diag = 0;
+    if (!checkpoint_config.filename.empty()) {
+        uint64_t my_last_diag = checkpoint_last_diag(checkpoint_config.filename, N);
+        MPI_Allreduce(&my_last_diag, &last_diag, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+        if (last_diag > 0 && (!topology.shared || topology.node_rank == 0)) {
+            auto base_config = checkpoint_config_from_env();
+            for (int r = 0; r < size; r++)
+                load_checkpoint(checkpoint_rank_filename(base_config.filename, r), M, N, last_diag - 1);
+            if (topology.shared) {
+                for (int r = rank; r < rank + topology.node_size; r++)
+                    load_checkpoint(checkpoint_rank_filename(base_config.filename, r), M, N, last_diag);
+            } else {
+                load_checkpoint(checkpoint_config.filename, M, N, last_diag);
+            }
+            for (size_t row = 0; row < N; row++) {
+                M[row][row] = double(row +1)/N;
+            }
+        }
+        if (last_diag > 0 && rank == 0)
+            cout << "Restarting from diagonal " << last_diag + 1 << endl;
+    }
+    unique_ptr<BasicCheckpointWriter<MatrixT>> checkpoint;
+    if (!checkpoint_config.filename.empty())
+        checkpoint = make_unique<BasicCheckpointWriter<MatrixT>>(checkpoint_config, M, N, last_diag, rank);
+    if (topology.shared) { // the initial diagonal (or the checkpoint) of the whole node is in place
+        sync_matrix(M);
+        MPI_Barrier(MPI_COMM_WORLD);
+        sync_matrix(M);
+    }
+
+    // rank 0 publishes the progress: after the barrier that ends each diagonal it knows the diagonal is complete.
+    // The busy fraction is the one of rank 0
+    auto progress_config = progress_config_from_env();
+    unique_ptr<ProgressMonitor> progress;
+    if (rank == 0 && !progress_config.filename.empty())
+        progress = make_unique<ProgressMonitor>(progress_config, N, 1, last_diag + 1);
 
-    for (size_t diag = 1; diag < N - 1; diag ++){
+    // the tail starts at the first diagonal shorter than the threshold; it is timed in both modes.
+    // Without agglomeration only the last element is left to rank 0
+    auto tail_config = tail_config_from_env(size);
+    size_t tail = min<size_t>(N - 1, max<size_t>(last_diag + 1, tail_config.threshold < N ? N - tail_config.threshold + 1 : 1));
+    size_t agglomerate = tail_config.agglomerate ? tail : N - 1;
+    auto tail_start = chrono::high_resolution_clock::now();
+
+    for (size_t diag = last_diag + 1; diag < agglomerate; diag ++){
+        if (diag == tail) tail_start = chrono::high_resolution_clock::now();
         se = compute_start_end(rank, size, N - diag); // compute first and last element to be processed by this process
         auto n_active_processes = min(size,int( N - diag ) + 1); // number of active processes (typically = size, but can be less for the last few iterations
         
         // first process does not need to check first
         if (rank == 0){
-            if (n_active_processes > 1){
+            if (n_active_processes > 1 && !share_next){
                check_last(se, diag, N, M, rank, requests, &need_col, row_to_send, col_to_receive); // check if we need the last column, or we need to give thelast row from/to the next process
             }
         }
         // last process does not need to check last element
-        if ( rank == n_active_processes -1){
+        if ( rank == n_active_processes -1 && !share_previous){
             check_first(se, diag, N, M, rank, requests, &need_row, col_to_send, row_to_receive); // check if we need the first row, or we need to give the first column from/to the previous process
         }
 
         // all other processes need to check both
         if (rank > 0 && rank < n_active_processes -1){
-            check_first(se, diag, N, M, rank, requests, &need_row, col_to_send, row_to_receive); 
-            check_last(se, diag, N, M, rank, requests, &need_col, row_to_send, col_to_receive);
+            if (!share_previous)
+                check_first(se, diag, N, M, rank, requests, &need_row, col_to_send, row_to_receive); 
+            if (!share_next)
+                check_last(se, diag, N, M, rank, requests, &need_col, row_to_send, col_to_receive);
         }
 
+        ProgressTimer timer(progress.get(), 0);
         compute_internal_part(se, diag, M, N); // compute the element in the middle of the chunk -> surely no dependencies
  
         auto rank_ull = static_cast<unsigned long long>(rank);
@@ -199,33 +467,35 @@ int main(int argc, char *argv[]){
             M[end_row][end_col] = temp;
             M[end_col][end_row] = temp;
 
+            if (checkpoint) checkpoint->segment_done(diag, se.start, se.end - se.start + 1);
         }
         // reset the flags
         need_row = false;
         need_col = false;
+        timer.stop();
+        sync_matrix(M);
         MPI_Barrier(MPI_COMM_WORLD);
+        sync_matrix(M);
+        if (progress) progress->diagonal_done(diag);
     }
 
-    // last step: compute the last element M[0][N-1] taking the missing column from process 1
-    if (rank == 0){
-        MPI_Recv(col_to_receive.data(), N, MPI_DOUBLE, 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // here I use a blocking receive because there is no possible computation overlap
+    if (checkpoint) checkpoint->finish(); // the tail is not checkpointed: a restart resumes before it
 
-        for (size_t j = 0; j < N - 1; j++) {
-            M[j +1][N-1] = col_to_receive[j];
-            M[N-1][j +1] = col_to_receive[j];
-        }
-        auto col = N -1;
-        auto row = 0;
-        double temp = 0;
-        for (size_t j = 0; j < N - 1; j++) {
-            temp += M[row][row + j] * M[col][col-j];
-        }
-        temp = cbrt(temp);
-        M[col][row] =temp;
-        M[row][col] = temp;
+    // last step: rank 0 gathers the rows and columns the tail reads and computes it (the last element only,
+    // without agglomeration)
+    if (tail >= agglomerate) tail_start = chrono::high_resolution_clock::now();
+    gather_tail_inputs(M, N, agglomerate, rank, size, topology);
+    if (rank == 0){
+        compute_tail(M, N, agglomerate, progress.get());
+        if (progress) progress->finish();
         auto end = chrono::high_resolution_clock::now();
         auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
         std::cout<<"duration "<<duration.count()<<endl;
+        chrono::duration<double> tail_seconds = end - tail_start, total_seconds = end - start;
+        std::cout << "tail (diagonals " << tail << " to " << N - 1 << ", " << (tail_config.agglomerate ? "on rank 0" : "distributed")
+                  << "): " << tail_seconds.count() << "s, " << 100 * tail_seconds.count() / total_seconds.count()
+                  << "% of the wall time" << endl;
+        if (checkpoint) checkpoint->print_stats(duration.count() / 1000.0);
 	    if ( argc > 2){
             auto filename = argv[2] ;
             ofstream outfile(filename, ios::app);
@@ -240,16 +510,66 @@ int main(int argc, char *argv[]){
         }
         cout << M[0][N-1] << endl;
     }
-        
-        if (rank == 1){
-        for (size_t j = 0; j < N - 1; j++) {
-            col_to_send[j] = M[j +1][N-1];
-        }
-        MPI_Send(col_to_send.data(), N, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+    if (topology.shared) { // the tail is in place for the validation and the result of rank 0
+        sync_matrix(M);
+        MPI_Barrier(MPI_COMM_WORLD);
+        sync_matrix(M);
+    }
+
+    bool valid = !validation_enabled() || validate_mpi(M, N, rank, size, agglomerate);
+
+    auto result_config = result_config_from_env();
+    if (!result_config.filename.empty())
+        write_result_mpi(result_config, M, N, rank, size, agglomerate);
+    return valid;
+}
+
+int main(int argc, char *argv[]){
+    MPI_Init(&argc, &argv);
+    auto start = chrono::high_resolution_clock::now();
+    int rank, size;
+
+    // argument check
+    if (argc < 2) {
+        cout << "Usage: " << argv[0] << " N" << "[filename]" << endl;
+        cout << "The tail (WF_MPI_TAIL) is computed with threads on rank 0 by parallel_mpi_omp, on one thread by parallel_mpi" << endl;
+        return 1;
     }
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (rank == 0)
+        std::cout << "using " << size << " processes" <<std::endl;
 
+    if (size < 2) {
+        // abort if there is only one process
+        cout << "This program is meant to be run with at least 2 processes" << endl;
+        MPI_Finalize();
+        return 1;
+    }
     
+    size_t N = atoi(argv[1]);
+    auto topology = node_topology(rank, size);
+    bool valid;
+    if (topology.shared) {
+        if (rank == 0)
+            cout << "matrix shared by the ranks of each node (" << topology.node_size << " on the node of rank 0): "
+                 << double(N) * N * sizeof(double) / (1 << 20) << " MiB per node" << endl;
+        SharedMatrix M(N, topology);
+        // the ranks of the node mark their share of the rows as not computed (-1)
+        auto rows = compute_start_end(topology.node_rank, topology.node_size, N);
+        for (size_t row = rows.start; row <= rows.end && row < N; row++) {
+            fill(M[row], M[row] + N, -1.0);
+        }
+        sync_matrix(M);
+        MPI_Barrier(topology.node_comm);
+        sync_matrix(M);
+        valid = run_wavefront(M, N, rank, size, topology, argc, argv, start);
+    } else {
+        Matrix M(N, Row(N, -1));
+        valid = run_wavefront(M, N, rank, size, topology, argc, argv, start);
+    }
+    MPI_Comm_free(&topology.node_comm);
 
     MPI_Finalize();
-    return 0;
+    return valid ? 0 : 1;
 }
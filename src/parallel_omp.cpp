@@ -8,25 +8,14 @@
 #include <fstream>
 #include <iomanip>
 #include <omp.h>
+#include "omp_wf.hpp"
+#include "result_wf.hpp"
+#include "reference_wf.hpp"
+#include "tuning_wf.hpp"
+#include "progress_wf.hpp"
+#include "roofline_wf.hpp"
 
-void inline compute_stencil_optim(std::vector<std::vector<double>> &M, const uint64_t &N) {
-    for(uint64_t diag = 1; diag < N; ++diag) { // for each upper diagonal
-        #pragma omp parallel for
-        for(uint64_t i = 0; i < (N-diag); ++i) { // for each elem. in the diagonal
-            auto i_plus_diag = i + diag;
-            double temp = 0.0;
-            // #pragma omp parallel for reduction(+:temp)
-            for (uint64_t j = 0; j < diag; ++j) { // for each elem. in the stencil
-                temp += M[i][i+j] * M[i_plus_diag][i_plus_diag - j];
-            }
-            M[i_plus_diag][i] = temp;
-            M[i_plus_diag][i] = std::cbrt(M[i_plus_diag][i]); // cube root
-            M[i][i_plus_diag] = M[i_plus_diag][i]; // store the result also in the upper triangle
-        }
-    }
-}
-
-void print_matrix(std::vector<std::vector<double>> &M) {
+void print_matrix(Matrix &M) {
     for (size_t i = 0; i < M.size(); i++) {
         for (size_t j = 0; j < M.size(); j++) {
             std::cout << std::fixed << std::setprecision(2) << M[i][j] << " ";
@@ -46,9 +35,15 @@ int main(int argc, char *argv[]) {
     if (argc > 1) {
         N = std::stol(argv[1]);
     }
+    // OMP_NUM_THREADS takes precedence over the number of threads found by autotune
+    TuningConfig tuned;
+    if (std::getenv("OMP_NUM_THREADS") == nullptr && lookup_tuning(N, tuned, "omp")) {
+        omp_set_num_threads(tuned.nworkers);
+        print_tuning(tuned);
+    }
 
     // allocate the matrix
-    std::vector<std::vector<double>> M(N, std::vector<double>(N, 0.0));
+    Matrix M(N, Row(N, 0.0));
 
     // initialize the matrix
     for (uint64_t i = 0; i < N; ++i) {
@@ -61,13 +56,28 @@ int main(int argc, char *argv[]) {
         M[i][i] = (double(i+1)) / double(N);
     }
 
+    auto progress_config = progress_config_from_env();
+    std::unique_ptr<ProgressMonitor> progress;
+    if (!progress_config.filename.empty())
+        progress = std::make_unique<ProgressMonitor>(progress_config, N, omp_get_max_threads());
+
+    std::unique_ptr<RooflineReport> roofline;
+    std::function<void(size_t)> on_diagonal_done = nullptr;
+    if (roofline_enabled()) {
+        roofline = std::make_unique<RooflineReport>(probe_machine(omp_get_max_threads()), N);
+        on_diagonal_done = [&](size_t diag) { roofline->diagonal_done(diag); };
+    }
+
     // compute stencil
     auto start = std::chrono::steady_clock::now();
-    compute_stencil_optim(M, N);
+    if (roofline) roofline->start();
+    compute_stencil_omp(M, N, progress.get(), on_diagonal_done);
+    if (progress) progress->finish();
     auto end = std::chrono::steady_clock::now();
     std::chrono::duration<double> elapsed_seconds = end - start;
 
     std::cout << "Elapsed time (parallel): " << elapsed_seconds.count() << "s\n";
+    if (roofline) roofline->print(elapsed_seconds.count(), "OpenMP");
 
     // write the result to a file, append
     std::ofstream file("result.txt", std::ios::app);
@@ -77,6 +87,12 @@ int main(int argc, char *argv[]) {
     } else {
         std::cout << "Unable to open file\n";
     }
+    if (validation_enabled() && !validate(M, N, "OpenMP"))
+        return -1;
+
+    auto result_config = result_config_from_env();
+    if (!result_config.filename.empty())
+        write_result(result_config, M, N);
     if (N < 10) {
         print_matrix(M);
     }
@@ -0,0 +1,84 @@
+#include "progress_wf.hpp"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <csignal>
+#include <cerrno>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s file [interval]\n", program_name);
+    std::printf("Prints the progress of a run started with WF_PROGRESS=file: current diagonal, elements completed,\n"
+                "instantaneous and average GFLOP/s, busy fraction of each worker and estimated time to completion.\n");
+    std::printf("     file: the progress file of the run\n");
+    std::printf("     interval: if given, prints the progress every interval seconds until the run ends\n");
+}
+
+std::string format_seconds(double seconds)
+{
+    if (seconds < 0) return "unknown";
+    uint64_t s = uint64_t(seconds + 0.5);
+    std::ostringstream out;
+    out << s / 3600 << "h " << std::setw(2) << std::setfill('0') << s / 60 % 60 << "m " << std::setw(2) << s % 60 << "s";
+    return out.str();
+}
+
+void print_progress(const ProgressReader &reader)
+{
+    auto s = reader.snapshot();
+    double elapsed = ((s.finished ? s.update_ns : monotonic_ns()) - s.start_ns) * 1e-9;
+    double since_update = (monotonic_ns() - s.update_ns) * 1e-9;
+    uint64_t total_elements = wavefront_elements_until(s.N, s.N - 1);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "pid " << s.pid << ", N = " << s.N << (s.finished ? ", finished" : "") << "\n";
+    std::cout << "  diagonal:  " << s.diag << " / " << s.N - 1 << "\n";
+    std::cout << "  elements:  " << s.elements_done << " / " << total_elements << " ("
+              << 100.0 * s.elements_done / std::max<uint64_t>(1, total_elements) << "%), work "
+              << 100.0 * s.work_done / std::max(1.0, s.total_work) << "%\n";
+    std::cout << "  GFLOP/s:   " << s.instant_gflops << " now, " << s.average_gflops << " average\n";
+    std::cout << "  elapsed:   " << format_seconds(elapsed) << ", last update " << since_update << "s ago\n";
+    if (!s.finished)
+        std::cout << "  ETA:       " << format_seconds(s.eta_seconds - since_update) << "\n";
+    std::cout << "  busy:     ";
+    for (uint32_t w = 0; w < s.nworkers; ++w)
+        std::cout << " " << std::setprecision(0) << 100 * reader.busy_fraction(w, s) << "%";
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")
+    {
+        show_help(argv[0]);
+        return argc < 2 || argc > 3 ? -1 : 0;
+    }
+    ProgressReader reader(argv[1]);
+    if (!reader.valid())
+    {
+        std::cout << "Error: " << argv[1] << " is not a progress file" << std::endl;
+        return -1;
+    }
+    if (argc == 2)
+    {
+        print_progress(reader);
+        return 0;
+    }
+    double interval = std::stod(argv[2]);
+    while (true)
+    {
+        print_progress(reader);
+        auto s = reader.snapshot();
+        if (s.finished) break;
+        if (kill(s.pid, 0) != 0 && errno == ESRCH)
+        {
+            std::cout << "process " << s.pid << " is not running anymore" << std::endl;
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+    }
+    return 0;
+}
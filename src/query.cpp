@@ -0,0 +1,89 @@
+#include "cone_wf.hpp"
+#include "sequential_wf.hpp"
+#include "progress_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s N [i j ...]\n", program_name);
+    std::printf("Computes only the elements M[i][j] (default M[0][N-1]) and the elements they depend on, the triangle\n"
+                "of the rows and columns i..j, and prints the work done against the full wavefront.\n");
+    std::printf("     N: size of the square matrix\n");
+    std::printf("     i j: the elements to compute\n");
+    std::printf("With WF_VALIDATE=1 the values are compared with the full sequential wavefront.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc % 2 != 0 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")
+    {
+        show_help(argv[0]);
+        return argc < 2 || argc % 2 != 0 ? -1 : 0;
+    }
+    uint64_t N = std::stoull(argv[1]);
+    if (N < 1)
+    {
+        std::cout << "Error: N must be greater than 0" << std::endl;
+        return -1;
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> elements;
+    for (int arg = 2; arg + 1 < argc; arg += 2)
+        elements.push_back({std::stoull(argv[arg]), std::stoull(argv[arg + 1])});
+    if (elements.empty())
+        elements.push_back({0, N - 1});
+    for (auto [i, j] : elements)
+    {
+        if (i >= N || j >= N)
+        {
+            std::cout << "Error: (" << i << ", " << j << ") is out of the matrix" << std::endl;
+            return -1;
+        }
+    }
+
+    ConeEvaluator cones(N, [N](uint64_t k) { return double(k + 1) / double(N); });
+    auto start = std::chrono::steady_clock::now();
+    auto values = cones.query(elements);
+    std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setprecision(17);
+    for (size_t e = 0; e < elements.size(); ++e)
+        std::cout << "M[" << elements[e].first << "][" << elements[e].second << "] = " << values[e] << std::endl;
+    double full_work = wavefront_work_until(N, N - 1);
+    double full_bytes = double(N) * N * sizeof(double);
+    std::cout << std::setprecision(4);
+    std::cout << "elapsed time: " << elapsed_seconds.count() << "s\n";
+    std::cout << "computed " << cones.stats().elements << " of " << wavefront_elements_until(N, N - 1) << " elements, "
+              << cones.stats().work << " multiply-adds (" << 100 * cones.stats().work / std::max(1.0, full_work)
+              << "% of the full wavefront), " << (cones.allocated_bytes() >> 10) << " KiB allocated ("
+              << 100 * cones.allocated_bytes() / full_bytes << "% of the full matrix)" << std::endl;
+
+    const char *validate = std::getenv("WF_VALIDATE");
+    if (validate != nullptr && std::string(validate) != "0")
+    {
+        Matrix M(N, Row(N, 0.0));
+        for (uint64_t i = 0; i < N; ++i)
+            M[i][i] = double(i + 1) / double(N);
+        start = std::chrono::steady_clock::now();
+        compute_stencil_optim(M, N);
+        elapsed_seconds = std::chrono::steady_clock::now() - start;
+        bool ok = true;
+        for (size_t e = 0; e < elements.size(); ++e)
+        {
+            double expected = M[elements[e].first][elements[e].second];
+            if (std::abs(values[e] - expected) > 1e-12 * std::max(1.0, std::abs(expected)))
+            {
+                std::cout << std::setprecision(17) << "M[" << elements[e].first << "][" << elements[e].second << "]: expected "
+                          << expected << ", computed " << values[e] << std::endl;
+                ok = false;
+            }
+        }
+        std::cout << "full sequential wavefront: " << elapsed_seconds.count() << "s" << std::endl;
+        std::cout << (ok ? "Validation passed: " : "Validation FAILED: ") << "the queried elements match the full wavefront" << std::endl;
+        return ok ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "result_wf.hpp"
+#include <iostream>
+#include <iomanip>
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc % 2 != 0) {
+        std::printf("use: %s filename [i j ...]\n", argv[0]);
+        std::printf("Reads a result file written with WF_RESULT=<filename>, verifies its checksum and prints M[0][N-1]\n");
+        std::printf("     i j: print also the elements M[i][j]\n");
+        return -1;
+    }
+    ResultView result(argv[1]);
+    if (!result.valid()) {
+        std::cout << "Error: " << argv[1] << " is not a valid result file" << std::endl;
+        return -1;
+    }
+    auto N = result.size();
+    std::cout << "N: " << N << ", precision: " << (result.precision() == 4 ? "single" : "double") << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = result.verify();
+    std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
+    std::cout << "checksum " << (ok ? "ok" : "MISMATCH") << " (" << elapsed_seconds.count() << "s)" << std::endl;
+
+    std::cout << std::setprecision(17) << "M[0][" << N - 1 << "] = " << result(0, N - 1) << std::endl;
+    for (int arg = 2; arg + 1 < argc; arg += 2) {
+        uint64_t i = std::stoull(argv[arg]);
+        uint64_t j = std::stoull(argv[arg + 1]);
+        if (i >= N || j >= N) {
+            std::cout << "Error: (" << i << ", " << j << ") is out of the matrix" << std::endl;
+            return -1;
+        }
+        std::cout << "M[" << i << "][" << j << "] = " << result(i, j) << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -9,9 +9,12 @@
 #include<cmath>
 #include<fstream>
 #include "sequential_wf.hpp"
+#include "checkpoint_wf.hpp"
+#include "result_wf.hpp"
+#include "roofline_wf.hpp"
 #include <iomanip>
 
-void print_matrix(std::vector<std::vector<double>> &M){
+void print_matrix(Matrix &M){
     for (size_t i = 0; i < M.size(); i++){
         for (size_t j = 0; j < M.size(); j++){
             std::cout << std::fixed << std::setprecision(2) << M[i][j] << " ";
@@ -38,7 +41,7 @@ int main( int argc, char *argv[] ) {
 
 
 	// allocate the matrix
-	std::vector<std::vector<double>> M(N, std::vector<double>(N, 0.0));
+	Matrix M(N, Row(N, 0.0));
 
     //init
 
@@ -52,13 +55,44 @@ int main( int argc, char *argv[] ) {
         M[i][i] = (double(i+1))/double(N);
     }
 
+    // restart from the checkpoint, if there is one
+    auto checkpoint_config = checkpoint_config_from_env();
+    uint64_t last_diag = 0;
+    if (!checkpoint_config.filename.empty()) {
+        last_diag = load_checkpoint(checkpoint_config.filename, M, N);
+        if (last_diag > 0)
+            std::cout << "Restarting from diagonal " << last_diag + 1 << "\n";
+    }
+
+    std::unique_ptr<RooflineReport> roofline;
+    if (roofline_enabled())
+        roofline = std::make_unique<RooflineReport>(probe_machine(1), N, last_diag + 1);
+
     // compute stencil
     auto start = std::chrono::steady_clock::now();
-    compute_stencil_optim(M, N);
+    if (roofline) roofline->start();
+    if (checkpoint_config.filename.empty() && !roofline) {
+        compute_stencil_optim(M, N);
+    } else if (checkpoint_config.filename.empty()) {
+        for (uint64_t diag = 1; diag < N; ++diag) {
+            compute_diagonal_optim(M, N, diag);
+            roofline->diagonal_done(diag);
+        }
+    } else {
+        CheckpointWriter checkpoint(checkpoint_config, M, N, last_diag);
+        for (uint64_t diag = last_diag + 1; diag < N; ++diag) {
+            compute_diagonal_optim(M, N, diag);
+            checkpoint.diagonal_done(diag);
+            if (roofline) roofline->diagonal_done(diag);
+        }
+        checkpoint.finish();
+        checkpoint.print_stats(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
     auto end = std::chrono::steady_clock::now();
     std::chrono::duration<double> elapsed_seconds = end-start;
 
     std::cout << "Elapsed time (sequential): " << elapsed_seconds.count() << "s\n";
+    if (roofline) roofline->print(elapsed_seconds.count(), "sequential");
     
     // write the result to a file, append
     std::ofstream file(filename, std::ios::app);
@@ -68,6 +102,9 @@ int main( int argc, char *argv[] ) {
     } else {
         std::cout << "Unable to open file\n";
     }
+    auto result_config = result_config_from_env();
+    if (!result_config.filename.empty())
+        write_result(result_config, M, N);
     std::cout <<M[0][N-1]<<std::endl;
 
     return 0;
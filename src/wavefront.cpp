@@ -0,0 +1,99 @@
+#include "dispatch_wf.hpp"
+#include "result_wf.hpp"
+#include "reference_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N, backend, nworkers, filename]\n", program_name);
+    std::printf("Computes the wavefront of a matrix of size N with the backend predicted to be the fastest for N on this\n"
+                "machine by the cost model (calibrated on the first run, see WF_COST_MODEL_FILE), or the one given.\n");
+    std::printf("     N: size of the square matrix (default 2048)\n");
+    std::printf("     backend: auto, sequential, farm, block_cyclic or omp (default auto)\n");
+    std::printf("     nworkers: number of workers (default: the tuned value, or the hardware threads)\n");
+    std::printf("     filename: name of the file to append the results to (default None, results are just printed)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t N = 2048;
+    WavefrontOptions options;
+    std::string filename;
+    if (argc > 5 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 5 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        N = std::stol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        options.backend = argv[2];
+    }
+    if (argc > 3)
+    {
+        options.nworkers = std::stoi(argv[3]);
+    }
+    if (argc > 4)
+    {
+        filename = argv[4];
+    }
+    auto backends = available_backends();
+    if (options.backend != "auto" && std::find(backends.begin(), backends.end(), options.backend) == backends.end())
+    {
+        std::cout << "Error: unknown backend " << options.backend << std::endl;
+        return -1;
+    }
+    if (N < 1 || options.nworkers < 0)
+    {
+        std::cout << "Error: N must be greater than 0" << std::endl;
+        return -1;
+    }
+
+    // the calibration runs (first run on a machine) happen here, outside of the timed part
+    auto choice = choose_backend(N, options);
+    print_choice(choice);
+    options.backend = choice.config.backend;
+    options.nworkers = choice.config.nworkers;
+    options.chunksize = choice.config.chunksize;
+    options.on_demand = choice.config.on_demand;
+    options.sync_mode = sync_mode_from_env();
+
+    Matrix M(N, Row(N, 0.0));
+    for (uint64_t i = 0; i < N; ++i)
+    {
+        M[i][i] = double(i + 1) / double(N);
+    }
+
+    auto progress_config = progress_config_from_env();
+    std::unique_ptr<ProgressMonitor> progress;
+    if (!progress_config.filename.empty())
+        progress = std::make_unique<ProgressMonitor>(progress_config, N, options.nworkers);
+    options.progress = progress.get();
+
+    auto start = std::chrono::steady_clock::now();
+    compute_wavefront(M, N, options);
+    if (progress) progress->finish();
+    std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
+    std::cout << "elapsed time: " << elapsed_seconds.count() << "s\n";
+    if (!filename.empty())
+    {
+        std::ofstream file(filename, std::ios_base::app);
+        file << N << " " << options.backend << " " << options.nworkers << " " << elapsed_seconds.count() << std::endl;
+    }
+
+    if (validation_enabled() && !validate(M, N, options.backend))
+        return -1;
+
+    auto result_config = result_config_from_env();
+    if (!result_config.filename.empty())
+        write_result(result_config, M, N);
+
+    std::cout << M[0][N - 1] << std::endl;
+    return 0;
+}
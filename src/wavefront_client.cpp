@@ -0,0 +1,161 @@
+#include "service_wf.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <string>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [N_list, jobs, connections, socket, filename]\n", program_name);
+    std::printf("       %s shutdown [socket]\n", program_name);
+    std::printf("Load generator for wavefront_server: each connection submits jobs one after the other (the sizes of\n"
+                "N_list in turn) until `jobs` jobs are done, then prints the latency percentiles and the throughput.\n");
+    std::printf("     N_list: sizes of the jobs, separated by commas (default 512)\n");
+    std::printf("     jobs: total number of jobs (default 100)\n");
+    std::printf("     connections: concurrent clients (default 1)\n");
+    std::printf("     socket: path of the server socket (default WF_SERVICE_SOCKET, or /tmp/wavefront.sock)\n");
+    std::printf("     filename: name of the file to append the results to (default None, results are just printed)\n");
+}
+
+double percentile(std::vector<double> sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, size_t(p / 100 * sorted.size()));
+    return sorted[index];
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<uint64_t> sizes = {512};
+    int jobs = 100;
+    int connections = 1;
+    std::string socket_path = service_socket_path();
+    std::string filename;
+    if (argc > 6 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 6 ? -1 : 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "shutdown")
+    {
+        int fd = service_connect(argc > 2 ? argv[2] : socket_path);
+        bool ok = fd >= 0 && service_shutdown(fd);
+        std::cout << (ok ? "server stopped" : "Error: cannot reach the server") << std::endl;
+        return ok ? 0 : -1;
+    }
+    if (argc > 1)
+    {
+        sizes.clear();
+        std::stringstream list(argv[1]);
+        std::string size;
+        while (std::getline(list, size, ','))
+            sizes.push_back(std::stoull(size));
+    }
+    if (argc > 2)
+    {
+        jobs = std::stoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        connections = std::stoi(argv[3]);
+    }
+    if (argc > 4)
+    {
+        socket_path = argv[4];
+    }
+    if (argc > 5)
+    {
+        filename = argv[5];
+    }
+    if (sizes.empty() || jobs < 1 || connections < 1)
+    {
+        std::cout << "Error: N_list, jobs and connections must not be empty or 0" << std::endl;
+        return -1;
+    }
+
+    std::vector<std::vector<double>> latencies(connections);
+    std::vector<double> compute_seconds(connections, 0), queue_seconds(connections, 0);
+    std::vector<int> failures(connections, 0);
+    std::vector<double> first_values(sizes.size(), 0);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < connections; ++c)
+    {
+        clients.emplace_back([&, c] {
+            int fd = service_connect(socket_path);
+            if (fd < 0)
+            {
+                failures[c] = jobs;
+                return;
+            }
+            for (int job = c; job < jobs; job += connections)
+            {
+                uint64_t N = sizes[job % sizes.size()];
+                JobResult result;
+                auto submitted = std::chrono::steady_clock::now();
+                if (!service_submit(fd, N, {}, result))
+                {
+                    failures[c] += (jobs - job + connections - 1) / connections;
+                    break;
+                }
+                std::chrono::duration<double> latency = std::chrono::steady_clock::now() - submitted;
+                if (result.response.status != 0)
+                {
+                    failures[c]++;
+                    continue;
+                }
+                latencies[c].push_back(latency.count());
+                compute_seconds[c] += result.response.compute_seconds;
+                queue_seconds[c] += result.response.queue_seconds;
+                if (job < int(sizes.size()))
+                    first_values[job] = result.values[0];
+            }
+            close(fd);
+        });
+    }
+    for (auto &client : clients)
+        client.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<double> all;
+    double compute = 0, queue = 0;
+    int failed = 0;
+    for (int c = 0; c < connections; ++c)
+    {
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+        compute += compute_seconds[c];
+        queue += queue_seconds[c];
+        failed += failures[c];
+    }
+    std::sort(all.begin(), all.end());
+    if (all.empty())
+    {
+        std::cout << "Error: no job completed (is wavefront_server running on " << socket_path << "?)" << std::endl;
+        return -1;
+    }
+    double p50 = percentile(all, 50), p99 = percentile(all, 99);
+    double overhead = 0;
+    for (auto latency : all) overhead += latency;
+    overhead = (overhead - compute - queue) / all.size(); // socket and protocol, per job
+
+    std::cout << std::setprecision(4);
+    for (size_t s = 0; s < sizes.size() && s < size_t(jobs); ++s)
+        std::cout << "M[0][" << sizes[s] - 1 << "] = " << first_values[s] << std::endl;
+    std::cout << all.size() << " jobs (" << failed << " failed) on " << connections << " connections in " << elapsed.count()
+              << "s: " << all.size() / elapsed.count() << " jobs/s\n";
+    std::cout << "latency: p50 " << p50 * 1e3 << "ms, p99 " << p99 * 1e3 << "ms, max " << all.back() * 1e3 << "ms; per job "
+              << compute / all.size() * 1e3 << "ms computing, " << queue / all.size() * 1e3 << "ms queued, "
+              << overhead * 1e3 << "ms in the socket" << std::endl;
+    if (!filename.empty())
+    {
+        std::ofstream file(filename, std::ios::app);
+        file << argv[1] << " " << connections << " " << all.size() << " " << all.size() / elapsed.count() << " " << p50 << " "
+             << p99 << std::endl;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+#include "dispatch_wf.hpp"
+#include "service_wf.hpp"
+#include "result_wf.hpp"
+#include <omp.h>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <condition_variable>
+#include <set>
+#include <sys/stat.h>
+
+void show_help(const char *program_name)
+{
+    std::printf("use: %s [socket, backend, nworkers, pool_size]\n", program_name);
+    std::printf("Serves wavefront jobs over a Unix domain socket (see include/service_wf.hpp for the protocol), one at a\n"
+                "time with all the workers, keeping the threads (OpenMP, and the FastFlow farms frozen) and the matrices\n"
+                "of the last sizes between jobs.\n");
+    std::printf("     socket: path of the socket (default WF_SERVICE_SOCKET, or /tmp/wavefront.sock)\n");
+    std::printf("     backend: auto, sequential, farm, block_cyclic or omp (default auto: the cost model chooses for each N)\n");
+    std::printf("     nworkers: number of workers (default: the tuned value, or the hardware threads)\n");
+    std::printf("     pool_size: matrices kept allocated, one per size, the least recently used is freed (default 4)\n");
+    std::printf("Result files (JOB_WRITE_RESULT) are written to WF_SERVICE_RESULT_DIR (default /tmp). The largest N accepted\n"
+                "is WF_SERVICE_MAX_N (default 32768).\n");
+}
+
+// the matrices of the last pool_size sizes: a job of the same N reuses the allocation (and its page mappings),
+// the kernels overwrite everything but the main diagonal
+class MatrixPool
+{
+public:
+    explicit MatrixPool(size_t capacity): capacity(capacity) {}
+
+    Matrix &get(uint64_t N)
+    {
+        for (auto it = pool.begin(); it != pool.end(); ++it)
+        {
+            if (it->first == N)
+            {
+                pool.splice(pool.begin(), pool, it); // most recently used first
+                hits++;
+                return pool.front().second;
+            }
+        }
+        if (pool.size() >= capacity)
+            pool.pop_back();
+        pool.emplace_front(N, Matrix(N, Row(N, 0.0)));
+        misses++;
+        return pool.front().second;
+    }
+
+    size_t hits = 0, misses = 0;
+
+private:
+    size_t capacity;
+    std::list<std::pair<uint64_t, Matrix>> pool;
+};
+
+struct Server
+{
+    std::string socket_path;
+    WavefrontOptions options;
+    CostModel model;
+    MatrixPool pool;
+    std::string result_dir = "/tmp";
+    uint64_t max_N = 32768;
+
+    std::mutex job_mutex; // one job at a time, each with all the workers
+    std::map<uint64_t, TuningConfig> choices;
+    // the FastFlow farms of the last configuration of each, frozen between jobs (see WavefrontFarm)
+    std::unique_ptr<WavefrontFarm> farm;
+    std::unique_ptr<block_cyclic::WavefrontFarm> block_cyclic_farm;
+    TuningConfig farm_config, block_cyclic_config;
+    uint64_t next_job = 0;
+    double busy_seconds = 0;
+    std::atomic<bool> stop{false};
+    int listen_fd = -1;
+
+    // the connections being served, so that run() can wake them up and wait for them before returning
+    std::mutex connections_mutex;
+    std::condition_variable connections_done;
+    std::set<int> open_fds;
+    size_t active_connections = 0;
+    static constexpr uint32_t MAX_OUTPUTS = 1 << 20;
+
+    Server(const std::string &socket_path, const WavefrontOptions &options, size_t pool_size):
+        socket_path(socket_path), options(options), pool(pool_size) {}
+
+    // as run_backend, on the frozen farms; a farm is only rebuilt when its configuration changes
+    void run_config(const TuningConfig &config, Matrix &M, uint64_t N)
+    {
+        if (config.backend == "farm")
+        {
+            if (!farm || farm_config.nworkers != config.nworkers)
+            {
+                farm.reset(); // its threads terminate before the new ones start
+                farm = std::make_unique<WavefrontFarm>(config.nworkers, false, options.sync_mode);
+                farm_config = config;
+            }
+            farm->run(M, N);
+        }
+        else if (config.backend == "block_cyclic")
+        {
+            if (!block_cyclic_farm || block_cyclic_config.nworkers != config.nworkers ||
+                block_cyclic_config.on_demand != config.on_demand)
+            {
+                block_cyclic_farm.reset();
+                block_cyclic_farm = std::make_unique<block_cyclic::WavefrontFarm>(config.nworkers, config.on_demand, options.sync_mode);
+                block_cyclic_config = config;
+            }
+            block_cyclic_farm->run(M, N, config.chunksize);
+        }
+        else
+        {
+            run_backend(config, M, N, 1, nullptr, nullptr, options.sync_mode);
+        }
+    }
+
+    // runs a job, with job_mutex held
+    JobResponse run_job(const JobRequest &request, const std::vector<double> &diagonal,
+                        const std::vector<uint64_t> &outputs, std::vector<double> &values, std::string &path)
+    {
+        JobResponse response;
+        response.job_id = next_job++;
+        uint64_t N = request.N;
+        auto choice = choices.find(N);
+        if (choice == choices.end())
+            choice = choices.emplace(N, choose_backend(N, options, &model).config).first;
+
+        Matrix &M = pool.get(N);
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < N; ++i)
+            M[i][i] = diagonal.empty() ? double(i + 1) / double(N) : diagonal[i];
+        run_config(choice->second, M, N);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        response.compute_seconds = elapsed.count();
+        busy_seconds += elapsed.count();
+
+        if (outputs.empty())
+            values.push_back(M[0][N - 1]);
+        for (size_t k = 0; k + 1 < outputs.size(); k += 2)
+            values.push_back(M[outputs[k]][outputs[k + 1]]);
+        if (request.flags & JOB_WRITE_RESULT)
+        {
+            ResultConfig config;
+            config.filename = result_dir + "/wavefront_job_" + std::to_string(response.job_id) + ".bin";
+            if (write_result(config, M, N))
+                path = config.filename;
+            else
+                response.status = -EIO;
+        }
+        response.n_values = values.size();
+        response.path_length = path.size();
+        return response;
+    }
+
+    void serve_connection(int fd)
+    {
+        try
+        {
+            serve_requests(fd);
+        }
+        catch (const std::exception &e) // e.g. bad_alloc: this connection is dropped, the server goes on
+        {
+            std::cerr << "wavefront_server: connection closed: " << e.what() << std::endl;
+        }
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        open_fds.erase(fd);
+        close(fd);
+        active_connections--;
+        connections_done.notify_all();
+    }
+
+    void serve_requests(int fd)
+    {
+        JobRequest request;
+        while (read_full(fd, &request, sizeof(request)))
+        {
+            JobResponse response;
+            if (request.magic != SERVICE_MAGIC)
+                break; // not a client of this protocol: the rest of the stream cannot be parsed
+            if (request.kind == SERVICE_SHUTDOWN)
+            {
+                write_full(fd, &response, sizeof(response));
+                stop = true;
+                shutdown(listen_fd, SHUT_RDWR); // wakes up accept
+                break;
+            }
+            bool valid = request.kind == SERVICE_JOB && request.N > 0 && request.N <= max_N &&
+                         request.n_outputs <= std::min<uint64_t>(MAX_OUTPUTS, request.N * request.N);
+            if (!valid)
+            {
+                response.status = -EINVAL; // the size of the rest of the request cannot be trusted
+                write_full(fd, &response, sizeof(response));
+                break;
+            }
+            std::vector<double> diagonal;
+            std::vector<uint64_t> outputs(2 * size_t(request.n_outputs));
+            if (request.flags & JOB_EXPLICIT_DIAGONAL)
+            {
+                diagonal.resize(request.N);
+                if (!read_full(fd, diagonal.data(), request.N * sizeof(double)))
+                    break;
+            }
+            if (!read_full(fd, outputs.data(), outputs.size() * sizeof(uint64_t)))
+                break;
+            for (auto index : outputs)
+                valid = valid && index < request.N;
+            if (!valid)
+            {
+                response.status = -EINVAL;
+                if (!write_full(fd, &response, sizeof(response)))
+                    break;
+                continue;
+            }
+
+            std::vector<double> values;
+            std::string path;
+            auto queued = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(job_mutex);
+                std::chrono::duration<double> waited = std::chrono::steady_clock::now() - queued;
+                response = run_job(request, diagonal, outputs, values, path);
+                response.queue_seconds = waited.count();
+            }
+            if (!write_full(fd, &response, sizeof(response)) || !write_full(fd, values.data(), values.size() * sizeof(double)) ||
+                !write_full(fd, path.data(), path.size()))
+                break;
+        }
+    }
+
+    int run()
+    {
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        auto address = service_address(socket_path);
+        unlink(socket_path.c_str());
+        if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            listen(listen_fd, 64) != 0)
+        {
+            std::perror(("wavefront_server " + socket_path).c_str());
+            return -1;
+        }
+        chmod(socket_path.c_str(), 0600); // jobs only from this user
+        std::cout << "listening on " << socket_path << std::endl;
+        while (!stop)
+        {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                open_fds.insert(fd);
+                active_connections++;
+            }
+            std::thread([this, fd] { serve_connection(fd); }).detach();
+        }
+        close(listen_fd);
+        unlink(socket_path.c_str());
+        {
+            // idle connections stop reading; the jobs already received complete and their results are sent
+            std::unique_lock<std::mutex> lock(connections_mutex);
+            for (int fd : open_fds)
+                shutdown(fd, SHUT_RD);
+            connections_done.wait(lock, [this] { return active_connections == 0; });
+        }
+        std::lock_guard<std::mutex> lock(job_mutex);
+        std::cout << next_job << " jobs served, " << busy_seconds << "s computing; matrix pool: " << pool.hits << " reused, "
+                  << pool.misses << " allocated" << std::endl;
+        return 0;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    std::string socket_path = service_socket_path();
+    WavefrontOptions options;
+    size_t pool_size = 4;
+    if (argc > 5 || (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")))
+    {
+        show_help(argv[0]);
+        return argc > 5 ? -1 : 0;
+    }
+    if (argc > 1)
+    {
+        socket_path = argv[1];
+    }
+    if (argc > 2)
+    {
+        options.backend = argv[2];
+    }
+    if (argc > 3)
+    {
+        options.nworkers = std::stoi(argv[3]);
+    }
+    if (argc > 4)
+    {
+        pool_size = std::stoul(argv[4]);
+    }
+    if (pool_size < 1 || options.nworkers < 0)
+    {
+        std::cout << "Error: pool_size must be greater than 0" << std::endl;
+        return -1;
+    }
+    auto backends = available_backends();
+    if (options.backend != "auto" && std::find(backends.begin(), backends.end(), options.backend) == backends.end())
+    {
+        std::cout << "Error: unknown backend " << options.backend << std::endl;
+        return -1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    options.sync_mode = sync_mode_from_env();
+
+    Server server(socket_path, options, pool_size);
+    if (const char *dir = std::getenv("WF_SERVICE_RESULT_DIR"))
+        server.result_dir = dir;
+    if (const char *max_N = std::getenv("WF_SERVICE_MAX_N"))
+        server.max_N = std::stoull(max_N);
+    // everything that can be done once is done before the first job: the cost model (calibrated if needed)
+    // and the OpenMP threads, which then wait for the next parallel region instead of being created per job
+    if (options.backend == "auto")
+    {
+        server.model = CostModel::load_or_calibrate(options.nworkers > 0 ? options.nworkers : default_workers());
+        server.model.print();
+    }
+    #pragma omp parallel
+    {
+        (void)omp_get_thread_num();
+    }
+    return server.run();
+}
@@ -1,85 +1,183 @@
 #include "farm_wf.hpp"
+#include "farm_block_cyclic.hpp"
 #include "sequential_wf.hpp"
+#include "omp_wf.hpp"
+#include "reference_wf.hpp"
+#include <omp.h>
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
 
+// ------------------------------------------------------------------
+// ---------------------------- WORK MODEL --------------------------
+// ------------------------------------------------------------------
+// Element i of diagonal d is a dot product of length d, so the wavefront does
+//   sum_{d=1}^{N-1} (N-d)*d = (N^3 - N)/6 multiply-adds (plus N(N-1)/2 cube roots).
+// Scaling N by cbrt(p) only keeps the work per worker constant for large N; here N_p is the smallest size whose
+// work is at least p times the work of the base size, and the efficiencies are corrected for the rounding of N.
 
-void print_matrix(std::vector<std::vector<double>> &M){
-    for (size_t i = 0; i < M.size(); i++){
-        for (size_t j = 0; j < M.size(); j++){
-            std::cout << std::fixed << std::setprecision(2) << M[i][j] << " ";
+long double wavefront_work(uint64_t N) {
+    long double n = N;
+    return (n * n * n - n) / 6;
+}
+
+uint64_t weak_scaling_size(uint64_t N1, int nworkers) {
+    long double target = wavefront_work(N1) * nworkers;
+    uint64_t N = std::max<uint64_t>(N1, uint64_t(std::cbrt(double(target) * 6)));
+    while (N > N1 && wavefront_work(N - 1) >= target) --N;
+    while (wavefront_work(N) < target) ++N;
+    return N;
+}
+
+void show_help(const char *program_name) {
+    std::printf("use: %s [N, thread_list, backends, repetitions, filename]\n", program_name);
+    std::printf("Weak scaling: for each number of workers p in thread_list, runs each backend on a fresh matrix of size N_p,\n"
+                "the smallest size with at least p times the work of size N, and the sequential version on the same sizes.\n"
+                "Prints, and appends to filename, a table with the weak and strong efficiency, the speedup, the Karp-Flatt serial\n"
+                "fraction and the memory per worker.\n");
+    std::printf("     N: size of the matrix for 1 worker (default 2048)\n");
+    std::printf("     thread_list: numbers of workers, separated by commas (default 1,2,4)\n");
+    std::printf("     backends: any of farm, block_cyclic, omp, separated by commas (default farm)\n");
+    std::printf("     repetitions: runs of each configuration, the median time is reported (default 1)\n");
+    std::printf("     filename: name of the file to append the table to (default None, the table is just printed)\n");
+}
+
+std::vector<std::string> split(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+// median time of `repetitions` runs of the backend, each on a freshly allocated and initialized matrix
+double run_backend(const std::string &backend, uint64_t N, int nworkers, int repetitions) {
+    std::vector<double> times;
+    for (int r = 0; r < repetitions; ++r) {
+        Matrix M(N, Row(N, 0.0));
+        for (uint64_t i = 0; i < N; ++i) {
+            M[i][i] = double(i + 1) / double(N);
         }
-        std::cout << std::endl;
+        if (backend == "omp") omp_set_num_threads(nworkers);
+        auto start = std::chrono::steady_clock::now();
+        if (backend == "sequential")
+            compute_stencil_optim(M, N);
+        else if (backend == "farm")
+            compute_stencil_par(M, N, nworkers);
+        else if (backend == "block_cyclic")
+            block_cyclic::compute_stencil_par(M, N, nworkers, std::max<size_t>(1, std::min<size_t>(8, N / nworkers)));
+        else if (backend == "omp")
+            compute_stencil_omp(M, N);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double>(end - start).count());
+        if (r == 0 && validation_enabled() && !validate(M, N, backend))
+            std::exit(-1);
     }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
 }
+
 int main(int argc, char *argv[]) {
-    uint64_t N = 2048;    // default size of the matrix (NxN)
-    int nworkers = 4;    // default number of workers
-    std::string filename ;
-    if(argc > 4) {
-        std::printf("use: %s [N, nworkers]\n", argv[0]);
-        std::printf("     N: size of the square matrix (default 2048)\n");
-        std::printf("     nworkers: number of workers (default 4)\n");
-        std::printf("     filename: name of the file to write the results to (default strong_scaling_results.txt)\n");
+    uint64_t N = 2048;    // size of the matrix for 1 worker
+    std::string thread_list = "1,2,4";
+    std::string backend_list = "farm";
+    int repetitions = 1;
+    std::string filename;
+    if (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        show_help(argv[0]);
+        return 0;
+    }
+    if (argc > 6) {
+        show_help(argv[0]);
         return -1;
     }
-    if(argc > 1) {
+    if (argc > 1) {
         N = std::stol(argv[1]);
     }
-    if(argc > 2) {
-        nworkers = std::stol(argv[2]);
+    if (argc > 2) {
+        thread_list = argv[2];
+    }
+    if (argc > 3) {
+        backend_list = argv[3];
+    }
+    if (argc > 4) {
+        repetitions = std::stoi(argv[4]);
     }
-    if(argc >3){
-        filename = argv[3];
+    if (argc > 5) {
+        filename = argv[5];
     }
 
-    if(N < 1) {
-        std::cout << "Error: N must be greater than 0" << std::endl;
+    if (N < 2) {
+        std::cout << "Error: N must be greater than 1" << std::endl;
         return -1;
     }
-    if(nworkers < 1) {
-        std::cout << "Error: nworkers must be greater than 0" << std::endl;
+    if (repetitions < 1) {
+        std::cout << "Error: repetitions must be greater than 0" << std::endl;
         return -1;
     }
-    // compute the value ofN scaled by the cube root of the number of workers
-    long double N_ld = N;
-    long double nworkers_ld = nworkers;
-    N = N_ld * std::cbrt(nworkers_ld);
-    size_t N_sz = N;
-    std::cout << "N: " << N_sz << std::endl;
+    std::vector<int> workers;
+    for (auto &item : split(thread_list)) {
+        workers.push_back(std::stoi(item));
+        if (workers.back() < 1) {
+            std::cout << "Error: the numbers of workers must be greater than 0" << std::endl;
+            return -1;
+        }
+    }
+    auto backends = split(backend_list);
+    for (auto &backend : backends) {
+        if (backend != "farm" && backend != "block_cyclic" && backend != "omp") {
+            std::cout << "Error: unknown backend " << backend << std::endl;
+            return -1;
+        }
+    }
 
-    std::vector<std::vector<double>> M(N_sz, std::vector<double>(N_sz, 0.0));
+    // sequential baselines, on fresh matrices of each size
+    double work_1 = double(wavefront_work(N));
+    double seq_1 = run_backend("sequential", N, 1, repetitions);
+    std::cout << "base N: " << N << ", sequential time: " << seq_1 << "s" << std::endl;
 
-    for(uint64_t i = 0; i < N_sz; ++i) {
-        M[i][i] = double(i+1)/double(N);
-    }
+    std::ostringstream table;
+    table << std::left << std::setw(13) << "backend" << std::setw(8) << "N" << std::setw(8) << "workers" << std::setw(12) << "time"
+          << std::setw(12) << "seq_time" << std::setw(11) << "work_ratio" << std::setw(10) << "weak_eff" << std::setw(11) << "strong_eff"
+          << std::setw(9) << "speedup" << std::setw(11) << "karp_flatt" << "MiB_per_worker" << "\n";
+    std::cout << table.str();
+    for (int nworkers : workers) {
+        uint64_t N_p = weak_scaling_size(N, nworkers);
+        double work_ratio = double(wavefront_work(N_p)) / work_1; // >= nworkers, because of the rounding of N
+        double seq_p = nworkers == 1 ? seq_1 : run_backend("sequential", N_p, 1, repetitions);
+        for (auto &backend : backends) {
+            double time = run_backend(backend, N_p, nworkers, repetitions);
+            // weak efficiency: time the base problem takes sequentially over the time per unit of work of the base problem
+            // on nworkers workers. Strong efficiency, speedup and Karp-Flatt are against the sequential run of size N_p
+            double weak_efficiency = seq_1 * work_ratio / nworkers / time;
+            double speedup = seq_p / time;
+            double strong_efficiency = speedup / nworkers;
+            double karp_flatt = nworkers > 1 ? (1 / speedup - 1.0 / nworkers) / (1 - 1.0 / nworkers) : 0;
+            double mib_per_worker = double(N_p) * N_p * sizeof(double) / (1024.0 * 1024.0) / nworkers;
 
-    auto start = std::chrono::steady_clock::now();
-    compute_stencil_par(M, N_sz, nworkers);
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> elapsed_seconds = end-start;
-    start = std::chrono::steady_clock::now();
-    compute_stencil_optim(M, N_sz);
-    end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> elapsed_seconds_seq = end-start;
-    std::cout << "elapsed time: " << elapsed_seconds.count() << "s\n";
-    std::cout << "elapsed time sequential: " << elapsed_seconds_seq.count() << "s\n";
-    // write time taken, number of workers, chunksize, and N to a file
+            std::ostringstream row;
+            row << std::left << std::setw(13) << backend << std::setw(8) << N_p << std::setw(8) << nworkers << std::setw(12) << time
+                << std::setw(12) << seq_p << std::setw(11) << std::setprecision(4) << work_ratio << std::setw(10) << weak_efficiency
+                << std::setw(11) << strong_efficiency << std::setw(9) << speedup << std::setw(11) << karp_flatt << mib_per_worker << "\n";
+            std::cout << row.str() << std::flush;
+            table << row.str();
+        }
+    }
 
-    if (argc > 3) {
-        std::cout << "writing to file" << filename << std::endl;
+    if (!filename.empty()) {
+        // the header is written only to a new file, so the runs of several jobs can be appended and plotted together
+        bool new_file = !std::ifstream(filename).good();
         std::ofstream file(filename, std::ios::app);
-
-        if (file.is_open()) {
-            file << N_sz << " " << nworkers     << " " << elapsed_seconds.count() << "\n";
-            file << N_sz << " " << "sequential" << " " << elapsed_seconds_seq.count() << " " << "\n";
-            file.close();
-        } else {
-            std::cout << "Unable to open file\n";
+        if (!file.is_open()) {
+            std::cout << "Unable to open file " << filename << std::endl;
+            return -1;
         }
+        std::string rows = table.str();
+        file << (new_file ? rows : rows.substr(rows.find('\n') + 1));
     }
     return 0;
 }
-
-